@@ -0,0 +1,122 @@
+/* check_bench.c */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/parser.h"
+#include "../include/symbol.h"
+
+// Type checker scaling benchmark: checks one long arithmetic chain,
+// `s = a + v + v + ... + v;`, at doubling lengths and reports the
+// analysis time per term, which stays flat when checking is linear in the
+// length of the chain. The first term `a` is a declared and assigned int,
+// an undeclared name, or a float, so that the chain is clean, fails on an
+// undeclared operand, or fails on a type mismatch deep at its bottom.
+//
+// Usage: check-bench [shortest] [longest]
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* generate_chain(const char* first, size_t terms) {
+    static const char prologue[] = "int v;\nv = 1;\nint s;\ns = ";
+    size_t capacity = sizeof(prologue) + strlen(first) + terms * 4 + 4;
+    char* buffer = malloc(capacity);
+    if (!buffer) return NULL;
+    size_t size = (size_t)snprintf(buffer, capacity, "%s%s", prologue, first);
+    for (size_t i = 1; i < terms; i++) {
+        memcpy(buffer + size, " + v", 4);
+        size += 4;
+    }
+    memcpy(buffer + size, ";\n", 3);
+    return buffer;
+}
+
+// Best analysis time for the chain, or a negative time if it could not be
+// parsed or analyzed; the errors found are stored in `errors`
+static double time_chain(const char* first, size_t terms, int reps, Sink* out, int* errors) {
+    char* input = generate_chain(first, terms);
+    if (!input) return -1;
+    InternTable atoms;
+    Lexer lexer;
+    TokenBuffer tokens;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the intern table\n");
+        free(input);
+        return -1;
+    }
+    lexer_init(&lexer, input, &atoms);
+    token_buffer_init(&tokens);
+    Parser* parser = parser_create();
+
+    double best = -1;
+    if (parser && lex_all(&lexer, &tokens) && parser_parse_tokens(parser, input, &tokens) != AST_NO_NODE) {
+        const Ast* ast = parser_ast(parser);
+        best = 1e30;
+        for (int r = 0; r < reps && best >= 0; r++) {
+            SymbolTable* table = init_symbol_table(&atoms, out);
+            Resolution resolution = {0};
+            if (!table) {
+                best = -1;
+                break;
+            }
+            double start = now_seconds();
+            *errors = analyze_semantics(ast, table, &resolution);
+            double end = now_seconds();
+            if (end - start < best) best = end - start;
+            resolution_free(&resolution);
+            free_symbol_table(table);
+        }
+    }
+
+    parser_destroy(parser);
+    token_buffer_free(&tokens);
+    intern_free(&atoms);
+    free(input);
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t shortest = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    size_t longest = argc > 2 ? strtoul(argv[2], NULL, 10) : 128000;
+    const int reps = 5;
+    if (shortest == 0) shortest = 1;
+    struct { const char* name; const char* first; } chains[] = {
+        { "clean     ", "v" },
+        { "undeclared", "u" },
+        { "mismatch  ", "1.5" },
+    };
+
+    // Diagnostics are written, as they would be, but thrown away
+    Sink out;
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0 || !sink_init(&out, null_fd)) {
+        fprintf(stderr, "Could not open /dev/null for the diagnostics\n");
+        return 1;
+    }
+
+    printf("%10s  %8s  %10s  %10s  %s\n", "chain", "terms", "check ms", "ns/term", "errors");
+    for (size_t c = 0; c < sizeof(chains) / sizeof(chains[0]); c++) {
+        for (size_t terms = shortest; terms <= longest; terms *= 2) {
+            int errors = 0;
+            double seconds = time_chain(chains[c].first, terms, reps, &out, &errors);
+            if (seconds < 0) {
+                fprintf(stderr, "Could not check a chain of %zu terms\n", terms);
+                return 1;
+            }
+            sink_flush(&out);
+            printf("%s  %8zu  %10.3f  %10.1f  %d\n", chains[c].name, terms, seconds * 1e3,
+                   seconds * 1e9 / terms, errors);
+        }
+    }
+
+    sink_close(&out);
+    close(null_fd);
+    return 0;
+}
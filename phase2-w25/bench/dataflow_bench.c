@@ -0,0 +1,239 @@
+/* dataflow_bench.c */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/cfg.h"
+#include "../include/dataflow.h"
+#include "../include/parser.h"
+#include "../include/symbol.h"
+
+// Dataflow scaling benchmark: builds the control-flow graph of a generated
+// program and solves definite assignment and liveness on it, at doubling
+// program sizes, and reports the time per statement of each step, which
+// stays flat when they are linear in the size of the program. The program
+// declares GLOBALS variables, then repeats one statement: an if with a
+// local, a while loop, or a repeat loop nested inside the previous ones,
+// the worst case for a solver that has to carry facts around loops.
+//
+// Usage: dataflow-bench [smallest] [largest]
+
+#define GLOBALS 64
+#define DEFINES 1
+#define ASSIGNED 2
+#define LIVE 4
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef enum { SHAPE_IFS, SHAPE_WHILES, SHAPE_NESTED } Shape;
+
+static char* generate_program(Shape shape, size_t statements) {
+    size_t capacity = GLOBALS * 32 + statements * 64 + 64;
+    char* buffer = malloc(capacity);
+    if (!buffer) return NULL;
+    size_t size = 0;
+    for (int g = 0; g < GLOBALS; g++) {
+        size += (size_t)snprintf(buffer + size, capacity - size, "int g%d;\n", g);
+        if (g % 2 == 0) size += (size_t)snprintf(buffer + size, capacity - size, "g%d = %d;\n", g, g);
+    }
+    for (size_t i = 0; i < statements; i++) {
+        int a = (int)(i % GLOBALS), b = (int)((i * 7 + 3) % GLOBALS);
+        switch (shape) {
+            case SHAPE_IFS:
+                size += (size_t)snprintf(buffer + size, capacity - size,
+                                         "if (g%d < 1) { int t; t = g%d; g%d = t; }\n", a, b, a);
+                break;
+            case SHAPE_WHILES:
+                size += (size_t)snprintf(buffer + size, capacity - size,
+                                         "while (g%d < 1) { g%d = g%d + 1; }\n", a, b, b);
+                break;
+            case SHAPE_NESTED:
+                size += (size_t)snprintf(buffer + size, capacity - size, "repeat { g%d = g%d;\n", b, a);
+                break;
+        }
+    }
+    for (size_t i = 0; shape == SHAPE_NESTED && i < statements; i++) {
+        size += (size_t)snprintf(buffer + size, capacity - size, "} until (g%d > 1);\n", (int)(i % GLOBALS));
+    }
+    return buffer;
+}
+
+// Which assignments liveness must mark, found without the dataflow
+// solver: for each slot, walk the graph backward from the blocks that read
+// the slot before writing it, stopping at blocks that write it. Returns 0
+// if the marks in `flags` differ, or if memory ran out.
+static int check_liveness(const Cfg* cfg, const uint8_t* flags, uint32_t node_count) {
+    uint32_t blocks = cfg->block_count;
+    uint8_t* exposed = malloc(blocks);
+    uint8_t* killed = malloc(blocks);
+    uint8_t* live_in = malloc(blocks);
+    uint8_t* live_out = malloc(blocks);
+    BlockId* stack = malloc(blocks * sizeof(BlockId));
+    uint8_t* expected = calloc(node_count, 1);
+    int ok = exposed && killed && live_in && live_out && stack && expected;
+    if (!ok) fprintf(stderr, "Memory allocation error for the liveness check\n");
+
+    for (uint32_t slot = 0; ok && slot < cfg->slot_count; slot++) {
+        uint32_t top = 0;
+        for (BlockId b = 0; b < blocks; b++) {
+            const BasicBlock* block = &cfg->blocks[b];
+            exposed[b] = killed[b] = live_in[b] = live_out[b] = 0;
+            for (uint32_t i = 0; i < block->event_count && !killed[b]; i++) {
+                const CfgEvent* event = &cfg->events[block->first_event + i];
+                if (event->slot != slot) continue;
+                if (event->kind == CFG_USE) exposed[b] = 1;
+                else killed[b] = 1;
+            }
+            if (exposed[b]) {
+                live_in[b] = 1;
+                stack[top++] = b;
+            }
+        }
+        while (top > 0) {
+            BlockId b = stack[--top];
+            const BlockId* predecessors = cfg_predecessors(cfg, b);
+            for (uint32_t i = 0; i < cfg->blocks[b].predecessor_count; i++) {
+                BlockId p = predecessors[i];
+                live_out[p] = 1;
+                if (!killed[p] && !live_in[p]) {
+                    live_in[p] = 1;
+                    stack[top++] = p;
+                }
+            }
+        }
+        for (BlockId b = 0; b < blocks; b++) {
+            const BasicBlock* block = &cfg->blocks[b];
+            int live = live_out[b];
+            for (uint32_t i = block->event_count; i-- > 0;) {
+                const CfgEvent* event = &cfg->events[block->first_event + i];
+                if (event->slot != slot) continue;
+                if (event->kind == CFG_ASSIGN && live) expected[event->node] = 1;
+                live = event->kind == CFG_USE;
+            }
+        }
+    }
+
+    for (NodeId id = 0; ok && id < node_count; id++) {
+        if (!(flags[id] & LIVE) != !expected[id]) {
+            fprintf(stderr, "Liveness differs from a graph search at node %u\n", id);
+            ok = 0;
+        }
+    }
+    free(exposed);
+    free(killed);
+    free(live_in);
+    free(live_out);
+    free(stack);
+    free(expected);
+    return ok;
+}
+
+typedef struct {
+    double build;
+    double assignment;
+    double liveness;
+} StepTimes;
+
+// Best time of each step on the program, or 0 if it could not be parsed
+// or analyzed, or liveness gave a wrong answer
+static int time_program(Shape shape, size_t statements, int reps, Sink* out, StepTimes* best) {
+    char* input = generate_program(shape, statements);
+    if (!input) return 0;
+    InternTable atoms;
+    Lexer lexer;
+    TokenBuffer tokens;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the intern table\n");
+        free(input);
+        return 0;
+    }
+    lexer_init(&lexer, input, &atoms);
+    token_buffer_init(&tokens);
+    Parser* parser = parser_create();
+    SymbolTable* table = init_symbol_table(&atoms, out);
+    Resolution resolution = {0};
+    uint8_t* flags = NULL;
+
+    int ok = parser && table && lex_all(&lexer, &tokens) &&
+             parser_parse_tokens(parser, input, &tokens) != AST_NO_NODE &&
+             resolve_names(parser_ast(parser), table, &resolution);
+    if (ok) {
+        const Ast* ast = parser_ast(parser);
+        flags = calloc(ast->count, 1);
+        ok = flags != NULL;
+        for (NodeId id = 0; ok && id < ast->count; id++) {
+            if (ast_node(ast, id)->type == AST_ASSIGN) flags[id] = DEFINES;
+        }
+        *best = (StepTimes){1e30, 1e30, 1e30};
+        for (int r = 0; r < reps && ok; r++) {
+            Cfg cfg;
+            double start = now_seconds();
+            ok = cfg_build(&cfg, ast, &resolution);
+            double built = now_seconds();
+            ok = ok && definite_assignment(&cfg, flags, DEFINES, ASSIGNED, NULL);
+            double assigned = now_seconds();
+            ok = ok && liveness(&cfg, flags, LIVE);
+            double live = now_seconds();
+            if (built - start < best->build) best->build = built - start;
+            if (assigned - built < best->assignment) best->assignment = assigned - built;
+            if (live - assigned < best->liveness) best->liveness = live - assigned;
+            if (ok && r == 0) ok = check_liveness(&cfg, flags, ast->count);
+            cfg_free(&cfg);
+        }
+    }
+
+    free(flags);
+    resolution_free(&resolution);
+    if (table) free_symbol_table(table);
+    parser_destroy(parser);
+    token_buffer_free(&tokens);
+    intern_free(&atoms);
+    free(input);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    size_t smallest = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    size_t largest = argc > 2 ? strtoul(argv[2], NULL, 10) : 64000;
+    const int reps = 5;
+    if (smallest == 0) smallest = 1;
+    struct { const char* name; Shape shape; } shapes[] = {
+        { "ifs   ", SHAPE_IFS },
+        { "whiles", SHAPE_WHILES },
+        { "nested", SHAPE_NESTED },
+    };
+
+    // Resolution reports nothing for these programs, but needs somewhere
+    // to write
+    Sink out;
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0 || !sink_init(&out, null_fd)) {
+        fprintf(stderr, "Could not open /dev/null for the diagnostics\n");
+        return 1;
+    }
+
+    printf("%6s  %10s  %12s  %12s  %12s\n", "shape", "statements", "cfg ns/st", "assign ns/st", "live ns/st");
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        for (size_t statements = smallest; statements <= largest; statements *= 2) {
+            StepTimes best;
+            if (!time_program(shapes[s].shape, statements, reps, &out, &best)) {
+                fprintf(stderr, "Could not analyze a program of %zu statements\n", statements);
+                return 1;
+            }
+            printf("%s  %10zu  %12.1f  %12.1f  %12.1f\n", shapes[s].name, statements,
+                   best.build * 1e9 / statements, best.assignment * 1e9 / statements,
+                   best.liveness * 1e9 / statements);
+        }
+    }
+
+    sink_close(&out);
+    close(null_fd);
+    return 0;
+}
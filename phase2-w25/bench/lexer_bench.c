@@ -0,0 +1,407 @@
+/* lexer_bench.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/lexer.h"
+
+// Lexer microbenchmark: lexes a generated multi-megabyte program with each
+// scanner implementation the CPU supports, with the DFA tokenizer and on
+// 2-16 threads, and reports throughput.
+//
+// Usage: lexer-bench [megabytes] [repetitions]
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Typical statements: mostly short names and single spaces
+static const char* typical_lines[] = {
+    "int counter_variable_with_long_name;\n",
+    "        accumulated_total_value = accumulated_total_value + 12345;\n",
+    "if (counter_variable_with_long_name < 1000000) {\n",
+    "    print \"a reasonably long string literal used for benchmarking the lexer\";\n",
+    "    while (index_into_table > 0) { index_into_table = index_into_table - 1; }\n",
+    "}\n",
+    "float ratio; ratio = 3.14159265 * 2.0;\n",
+    "char letter; letter = 'q';\n",
+    "\t\t\t\n\n",
+    NULL
+};
+
+// Machine-generated style: deep indentation, long names and long literals
+static const char* wide_lines[] = {
+    "                                                                int generated_identifier_with_a_very_long_descriptive_name_0001;\n",
+    "                                                                generated_identifier_with_a_very_long_descriptive_name_0001 = 123456789012345;\n",
+    "                                                                print \"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation\";\n",
+    "\n\n\n\n\n\n\n\n",
+    NULL
+};
+
+// String literals that run over several lines, so chunk cuts land inside them
+static const char* literal_lines[] = {
+    "print \"a string literal that\n",
+    "spans three lines of the input\n",
+    "before it is closed\";\n",
+    "char newline; newline = '\n';\n",
+    "x = x + 1;\n",
+    NULL
+};
+
+// Build a program of roughly `target` bytes by cycling through `lines`
+static char* generate_input(const char** lines, size_t target, size_t* out_size) {
+    size_t count = 0;
+    while (lines[count]) count++;
+    char* buffer = malloc(target + 1024);
+    size_t size = 0;
+    if (!buffer) return NULL;
+    for (size_t i = 0; size < target; i++) {
+        const char* line = lines[i % count];
+        size_t len = strlen(line);
+        memcpy(buffer + size, line, len);
+        size += len;
+    }
+    buffer[size] = '\0';
+    *out_size = size;
+    return buffer;
+}
+
+// Lex the whole buffer, returning the token count (and the final line
+// count); 0 if out of memory
+static size_t lex_input(const char* input, const ScanOps* ops, LexerEngine engine, int* lines) {
+    Lexer lexer;
+    Token token;
+    InternTable atoms;
+    size_t tokens = 0;
+    *lines = 0;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the intern table\n");
+        return 0;
+    }
+    lexer_init(&lexer, input, &atoms);
+    lexer.scan = ops;
+    lexer.engine = engine;
+    do {
+        token = lexer_next(&lexer);
+        tokens++;
+    } while (token.type != TOKEN_EOF);
+    *lines = lexer.line;
+    intern_free(&atoms);
+    return tokens;
+}
+
+static int same_tokens(const TokenBuffer* a, const TokenBuffer* b) {
+    return a->count == b->count &&
+           memcmp(a->types, b->types, a->count * sizeof(*a->types)) == 0 &&
+           memcmp(a->errors, b->errors, a->count * sizeof(*a->errors)) == 0 &&
+           memcmp(a->offsets, b->offsets, a->count * sizeof(*a->offsets)) == 0 &&
+           memcmp(a->lengths, b->lengths, a->count * sizeof(*a->lengths)) == 0 &&
+           memcmp(a->lines, b->lines, a->count * sizeof(*a->lines)) == 0 &&
+           memcmp(a->atoms, b->atoms, a->count * sizeof(*a->atoms)) == 0;
+}
+
+// Statements without quotes, so nothing closes a literal opened among them
+static const char* plain_lines[] = {
+    "int counter;\n",
+    "counter = counter + 12345;\n",
+    "while (counter > 0) { counter = counter - 1; }\n",
+    NULL
+};
+
+// An unterminated literal runs to the end of the input, across every
+// chunk cut after it. Lexing in parallel must still give the sequential
+// token stream, with a single EOF, whichever chunk the literal starts in.
+static int check_unterminated_literals(void) {
+    static const char* openers[] = { "print \"never closed;\n", "c = 'xy;\n" };
+    static const int eighths[] = { 1, 4, 7 };
+    size_t size;
+    char* program = generate_input(plain_lines, 4 << 20, &size);
+    char* input = program ? malloc(size + 64) : NULL;
+    int ok = input != NULL;
+    for (size_t o = 0; ok && o < sizeof(openers) / sizeof(openers[0]); o++) {
+        for (size_t e = 0; ok && e < sizeof(eighths) / sizeof(eighths[0]); e++) {
+            // Open the literal at the start of a line, then keep the rest
+            size_t at = size / 8 * eighths[e];
+            while (at > 0 && program[at - 1] != '\n') at--;
+            size_t length = strlen(openers[o]);
+            memcpy(input, program, at);
+            memcpy(input + at, openers[o], length);
+            memcpy(input + at + length, program + at, size - at + 1);
+
+            Lexer lexer;
+            InternTable atoms;
+            TokenBuffer expected;
+            if (!intern_init(&atoms)) {
+                fprintf(stderr, "Memory allocation error for the intern table\n");
+                ok = 0;
+                break;
+            }
+            lexer_init(&lexer, input, &atoms);
+            lexer.quiet = 1;
+            token_buffer_init(&expected);
+            ok = lex_all(&lexer, &expected);
+            intern_free(&atoms);
+            for (int threads = 2; ok && threads <= 16; threads *= 2) {
+                TokenBuffer buffer;
+                if (!intern_init(&atoms)) {
+                    fprintf(stderr, "Memory allocation error for the intern table\n");
+                    ok = 0;
+                    break;
+                }
+                lexer_init(&lexer, input, &atoms);
+                lexer.quiet = 1;
+                token_buffer_init(&buffer);
+                ok = lex_all_parallel(&lexer, &buffer, threads) && same_tokens(&buffer, &expected);
+                if (!ok) {
+                    fprintf(stderr, "parallel x%d: token stream differs from sequential lexing "
+                            "with an unterminated literal at byte %zu\n", threads, at);
+                }
+                token_buffer_free(&buffer);
+                intern_free(&atoms);
+            }
+            token_buffer_free(&expected);
+        }
+    }
+    free(input);
+    free(program);
+    return ok;
+}
+
+// The stream lexer empties the intern table whenever its window moves on,
+// so over a stream of distinct names the table never holds more atoms
+// than a window has bytes
+static int check_stream_atoms(void) {
+    FILE* file = tmpfile();
+    if (!file) {
+        fprintf(stderr, "Could not write temporary input for the streaming lexer\n");
+        return 0;
+    }
+    for (int i = 0; i < 500000; i++) fprintf(file, "name_%07d = value_%07d;\n", i, i);
+    if (fflush(file) != 0) {
+        fclose(file);
+        return 0;
+    }
+    lseek(fileno(file), 0, SEEK_SET);
+
+    InternTable atoms;
+    StreamLexer stream;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the intern table\n");
+        fclose(file);
+        return 0;
+    }
+    int ok = stream_lexer_init(&stream, fileno(file), 64 * 1024, &atoms);
+    if (ok) {
+        uint32_t most = 0;
+        Token token;
+        do {
+            token = stream_lexer_next(&stream, NULL, NULL);
+            if (atoms.count > most) most = atoms.count;
+        } while (token.type != TOKEN_EOF);
+        ok = !stream.failed && most <= ATOM_PREDEFINED_COUNT + stream.capacity;
+        if (!ok) fprintf(stderr, "stream: intern table grew to %u atoms over a stream of distinct names\n", most);
+        stream_lexer_free(&stream);
+    }
+    intern_free(&atoms);
+    fclose(file);
+    return ok;
+}
+
+// Time every supported scanner on one input; returns 0 if they disagree
+static int run_corpus(const char* name, const char* input, size_t size, int reps) {
+    const ScanOps* candidates[] = { scan_ops_scalar(), scan_ops_sse2(), scan_ops_avx2() };
+    double baseline = 0;
+    size_t expected_tokens = 0;
+    int expected_lines = 0;
+
+    printf("%s input: %.1f MiB, %d repetitions\n", name, size / 1048576.0, reps);
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        const ScanOps* ops = candidates[i];
+        if (!ops) continue;
+
+        double best = 1e30;
+        size_t tokens = 0;
+        int lines = 0;
+        for (int r = 0; r < reps; r++) {
+            double start = now_seconds();
+            tokens = lex_input(input, ops, LEXER_HANDWRITTEN, &lines);
+            double elapsed = now_seconds() - start;
+            if (tokens == 0) return 0;
+            if (elapsed < best) best = elapsed;
+        }
+
+        if (i == 0) {
+            baseline = best;
+            expected_tokens = tokens;
+            expected_lines = lines;
+        } else if (tokens != expected_tokens || lines != expected_lines) {
+            fprintf(stderr, "%s: token/line count mismatch (%zu/%d vs %zu/%d)\n",
+                    ops->name, tokens, lines, expected_tokens, expected_lines);
+            return 0;
+        }
+        printf("  %-8s %8.2f ms  %8.1f MiB/s  %zu tokens  %d lines  x%.2f\n",
+               ops->name, best * 1e3, size / 1048576.0 / best, tokens, lines, baseline / best);
+    }
+
+    // Table-driven DFA tokenizer (does not use the run scanners)
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        int lines = 0;
+        double start = now_seconds();
+        size_t tokens = lex_input(input, scan_ops_scalar(), LEXER_DFA, &lines);
+        double elapsed = now_seconds() - start;
+        if (tokens == 0) return 0;
+        if (tokens != expected_tokens || lines != expected_lines) {
+            fprintf(stderr, "dfa: token/line count mismatch (%zu/%d vs %zu/%d)\n",
+                    tokens, lines, expected_tokens, expected_lines);
+            return 0;
+        }
+        if (elapsed < best) best = elapsed;
+    }
+    printf("  %-8s %8.2f ms  %8.1f MiB/s  x%.2f\n",
+           "dfa", best * 1e3, size / 1048576.0 / best, baseline / best);
+
+    // Batch mode: the same work, stored into a struct-of-arrays TokenBuffer
+    best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        Lexer lexer;
+        InternTable atoms;
+        TokenBuffer buffer;
+        if (!intern_init(&atoms)) {
+            fprintf(stderr, "Memory allocation error for the intern table\n");
+            return 0;
+        }
+        lexer_init(&lexer, input, &atoms);
+        token_buffer_init(&buffer);
+        double start = now_seconds();
+        int ok = lex_all(&lexer, &buffer);
+        double elapsed = now_seconds() - start;
+        if (!ok || buffer.count != expected_tokens) {
+            fprintf(stderr, "batch: token count mismatch (%u vs %zu)\n", buffer.count, expected_tokens);
+            token_buffer_free(&buffer);
+            intern_free(&atoms);
+            return 0;
+        }
+        if (elapsed < best) best = elapsed;
+        token_buffer_free(&buffer);
+        intern_free(&atoms);
+    }
+    printf("  %-8s %8.2f ms  %8.1f MiB/s  (%s scanners into a TokenBuffer)\n",
+           "batch", best * 1e3, size / 1048576.0 / best, scan_ops_best()->name);
+
+    // Parallel batch mode; the merged stream must match the sequential one
+    Lexer lexer;
+    InternTable atoms;
+    TokenBuffer expected;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the intern table\n");
+        return 0;
+    }
+    lexer_init(&lexer, input, &atoms);
+    token_buffer_init(&expected);
+    int ok = lex_all(&lexer, &expected);
+    intern_free(&atoms);
+    for (int threads = 2; ok && threads <= 16; threads *= 2) {
+        best = 1e30;
+        for (int r = 0; ok && r < reps; r++) {
+            TokenBuffer buffer;
+            if (!intern_init(&atoms)) {
+                fprintf(stderr, "Memory allocation error for the intern table\n");
+                ok = 0;
+                break;
+            }
+            lexer_init(&lexer, input, &atoms);
+            token_buffer_init(&buffer);
+            double start = now_seconds();
+            ok = lex_all_parallel(&lexer, &buffer, threads);
+            double elapsed = now_seconds() - start;
+            if (!ok || !same_tokens(&buffer, &expected)) {
+                fprintf(stderr, "parallel x%d: token stream differs from sequential lexing\n", threads);
+                ok = 0;
+            }
+            if (elapsed < best) best = elapsed;
+            token_buffer_free(&buffer);
+            intern_free(&atoms);
+        }
+        if (ok) {
+            printf("  %-8s %8.2f ms  %8.1f MiB/s  (%d threads, %ld cores online)\n", "parallel",
+                   best * 1e3, size / 1048576.0 / best, threads, sysconf(_SC_NPROCESSORS_ONLN));
+        }
+    }
+    token_buffer_free(&expected);
+    if (!ok) return 0;
+
+    // Streaming mode: read the input back from a file in 64 KiB chunks
+    FILE* file = tmpfile();
+    if (!file || fwrite(input, 1, size, file) != size || fflush(file) != 0) {
+        fprintf(stderr, "Could not write temporary input for the streaming lexer\n");
+        if (file) fclose(file);
+        return 0;
+    }
+    best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        StreamLexer stream;
+        InternTable atoms;
+        Token token;
+        size_t tokens = 0;
+        lseek(fileno(file), 0, SEEK_SET);
+        if (!intern_init(&atoms)) {
+            fprintf(stderr, "Memory allocation error for the intern table\n");
+            fclose(file);
+            return 0;
+        }
+        double start = now_seconds();
+        if (!stream_lexer_init(&stream, fileno(file), 64 * 1024, &atoms)) {
+            intern_free(&atoms);
+            fclose(file);
+            return 0;
+        }
+        do {
+            token = stream_lexer_next(&stream, NULL, NULL);
+            tokens++;
+        } while (token.type != TOKEN_EOF);
+        double elapsed = now_seconds() - start;
+        int lines = (int)(stream.line_base + stream.lexer.line);
+        stream_lexer_free(&stream);
+        intern_free(&atoms);
+        if (tokens != expected_tokens || lines != expected_lines) {
+            fprintf(stderr, "stream: token/line count mismatch (%zu/%d vs %zu/%d)\n",
+                    tokens, lines, expected_tokens, expected_lines);
+            fclose(file);
+            return 0;
+        }
+        if (elapsed < best) best = elapsed;
+    }
+    fclose(file);
+    printf("  %-8s %8.2f ms  %8.1f MiB/s  (64 KiB chunks from a file)\n",
+           "stream", best * 1e3, size / 1048576.0 / best);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 16;
+    int reps = argc > 2 ? atoi(argv[2]) : 5;
+    struct { const char* name; const char** lines; } corpora[] = {
+        { "typical", typical_lines },
+        { "wide", wide_lines },
+        { "literals", literal_lines },
+    };
+
+    if (!check_unterminated_literals() || !check_stream_atoms()) return 1;
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        size_t size;
+        char* input = generate_input(corpora[i].lines, megabytes << 20, &size);
+        if (!input) {
+            fprintf(stderr, "Memory allocation error for benchmark input\n");
+            return 1;
+        }
+        int ok = run_corpus(corpora[i].name, input, size, reps);
+        free(input);
+        if (!ok) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+/* parser_bench.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/parser.h"
+
+// Parser microbenchmark: parses generated programs of a few million
+// nodes repeatedly from one token buffer, reusing a single parser session,
+// and reports parse and teardown times, then times incremental reparses
+// after a one-byte edit near the start, middle and end of the program.
+//
+// Usage: parser-bench [statements] [repetitions]
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Mixed statements: declarations, control flow and short expressions
+static const char* statement_lines[] = {
+    "int counter;\n",
+    "counter = counter + 12 * (total - 3) / 4;\n",
+    "if (counter < 1000) { int inner; inner = counter * 2; print inner; }\n",
+    "while (counter > 0) { counter = counter - 1; }\n",
+    "float ratio; ratio = 3.5 * 2.0 + 1.25;\n",
+    NULL
+};
+
+// Long expressions mixing every precedence level
+static const char* expression_lines[] = {
+    "x = a + b * c - d / e + f * (g - h) * i + j < k * l + m - n / o;\n",
+    "y = (a * b + c * d) / (e - f) + g * h * i - j / k / l == m + n * o;\n",
+    "print a - b - c - d - e + f * g * h * i / j / k + (l < m) * n != o;\n",
+    NULL
+};
+
+static char* generate_input(const char** lines, size_t count, size_t* out_size) {
+    size_t kinds = 0, capacity = 0, size = 0;
+    while (lines[kinds]) {
+        size_t len = strlen(lines[kinds++]);
+        if (len > capacity) capacity = len;
+    }
+    capacity = capacity * count + 1;
+    char* buffer = malloc(capacity);
+    if (!buffer) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        const char* line = lines[i % kinds];
+        size_t len = strlen(line);
+        memcpy(buffer + size, line, len);
+        size += len;
+    }
+    buffer[size] = '\0';
+    *out_size = size;
+    return buffer;
+}
+
+// Whether the reparsed session holds exactly what a fresh parse of the
+// same text gave: nodes, child edges, root and diagnostics
+static int same_parse(const Parser* reparsed, const Parser* fresh) {
+    const Ast* a = parser_ast(reparsed);
+    const Ast* b = parser_ast(fresh);
+    if (a->count != b->count || a->child_total != b->child_total || a->root != b->root ||
+        memcmp(a->children, b->children, a->child_total * sizeof(NodeId)) != 0) {
+        return 0;
+    }
+    for (NodeId id = 0; id < a->count; id++) {
+        const ASTNode* x = ast_node(a, id);
+        const ASTNode* y = ast_node(b, id);
+        if (x->type != y->type || x->token_type != y->token_type || x->error != y->error ||
+            x->offset != y->offset || x->length != y->length || x->line != y->line ||
+            x->atom != y->atom || x->first_child != y->first_child || x->child_count != y->child_count) {
+            return 0;
+        }
+    }
+    return parser_error_count(reparsed) == parser_error_count(fresh) &&
+           strcmp(parser_diagnostics(reparsed), parser_diagnostics(fresh)) == 0;
+}
+
+// Parse `input` from scratch in `fresh` and compare it with the reparse
+static int check_reparse(const Parser* reparsed, Parser* fresh, const char* input, InternTable* atoms,
+                         const char* edit, size_t at) {
+    if (parser_parse(fresh, input, atoms) == AST_NO_NODE) return 0;
+    if (same_parse(reparsed, fresh)) return 1;
+    fprintf(stderr, "Reparse after %s at byte %zu differs from a fresh parse\n", edit, at);
+    return 0;
+}
+
+// Best time to reparse after inserting a letter before the first ';' at or
+// after `at`, which lengthens a name, and after deleting it again; each
+// result is checked against a fresh parse of the text. Negative if a
+// reparse failed or differed.
+static double time_edit(Parser* parser, const char* input, size_t size, size_t at,
+                        InternTable* atoms, int reps) {
+    while (at < size && input[at] != ';') at++;
+    if (at == size) return 0;
+    char* edited = malloc(size + 2);
+    Parser* fresh = parser_create();
+    if (!edited || !fresh) {
+        free(edited);
+        parser_destroy(fresh);
+        return -1;
+    }
+    memcpy(edited, input, at);
+    edited[at] = 'x';
+    memcpy(edited + at + 1, input + at, size - at + 1);
+
+    double best = 1e30;
+    TextEdit insert = {at, 0, 1}, remove = {at, 1, 0};
+    for (int r = 0; r < reps; r++) {
+        double start = now_seconds();
+        NodeId root = parser_reparse(parser, edited, atoms, insert);
+        double inserted = now_seconds() - start;
+        if (root == AST_NO_NODE || !check_reparse(parser, fresh, edited, atoms, "inserting", at)) {
+            best = -1;
+            break;
+        }
+        start = now_seconds();
+        NodeId back = parser_reparse(parser, input, atoms, remove);
+        double deleted = now_seconds() - start;
+        if (back == AST_NO_NODE || !check_reparse(parser, fresh, input, atoms, "deleting", at)) {
+            best = -1;
+            break;
+        }
+        if (inserted < best) best = inserted;
+        if (deleted < best) best = deleted;
+    }
+    parser_destroy(fresh);
+    free(edited);
+    return best;
+}
+
+static int run_corpus(const char* name, const char** lines, size_t count, int reps) {
+    size_t size;
+    char* input = generate_input(lines, count, &size);
+    if (!input) {
+        fprintf(stderr, "Memory allocation error for benchmark input\n");
+        return 0;
+    }
+
+    InternTable atoms;
+    Lexer lexer;
+    TokenBuffer tokens;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the intern table\n");
+        free(input);
+        return 0;
+    }
+    lexer_init(&lexer, input, &atoms);
+    token_buffer_init(&tokens);
+    if (!lex_all(&lexer, &tokens)) {
+        fprintf(stderr, "Memory allocation error while lexing\n");
+        return 0;
+    }
+    printf("%s: %zu statements, %.1f MiB, %u tokens, %d repetitions\n",
+           name, count, size / 1048576.0, tokens.count, reps);
+
+    Parser* parser = parser_create();
+    if (!parser) {
+        fprintf(stderr, "Memory allocation error for the parser\n");
+        return 0;
+    }
+    double best_parse = 1e30, first_parse = 0;
+    uint32_t node_count = 0, edge_count = 0;
+    for (int r = 0; r < reps; r++) {
+        double start = now_seconds();
+        NodeId root = parser_parse_tokens(parser, input, &tokens);
+        double parsed = now_seconds();
+        if (root == AST_NO_NODE) {
+            fprintf(stderr, "Parse failed\n");
+            return 0;
+        }
+        node_count = parser_ast(parser)->count;
+        edge_count = parser_ast(parser)->child_total;
+        if (r == 0) first_parse = parsed - start;
+        if (parsed - start < best_parse) best_parse = parsed - start;
+    }
+    size_t edit_at[3] = {0, size / 2, size > 100 ? size - 100 : 0};
+    double edit_times[3];
+    for (int i = 0; i < 3; i++) {
+        edit_times[i] = time_edit(parser, input, size, edit_at[i], &atoms, reps);
+        if (edit_times[i] < 0) {
+            fprintf(stderr, "Reparse failed\n");
+            return 0;
+        }
+    }
+
+    double start = now_seconds();
+    parser_destroy(parser);
+    double destroyed = now_seconds();
+
+    printf("  %u nodes, %u child edges, %.1f bytes per node\n", node_count, edge_count,
+           (node_count * sizeof(ASTNode) + edge_count * sizeof(NodeId)) / (double)node_count);
+    printf("  parse (fresh session) %8.2f ms\n", first_parse * 1e3);
+    printf("  parse (reused session)%8.2f ms  %6.1f Mtokens/s\n",
+           best_parse * 1e3, tokens.count / best_parse / 1e6);
+    printf("  reparse, edit at start%8.4f ms\n", edit_times[0] * 1e3);
+    printf("  reparse, edit mid-file%8.4f ms\n", edit_times[1] * 1e3);
+    printf("  reparse, edit at end  %8.4f ms\n", edit_times[2] * 1e3);
+    printf("  destroy session       %8.4f ms\n", (destroyed - start) * 1e3);
+
+    token_buffer_free(&tokens);
+    intern_free(&atoms);
+    free(input);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 500000;
+    int reps = argc > 2 ? atoi(argv[2]) : 5;
+    struct { const char* name; const char** lines; } corpora[] = {
+        { "statements", statement_lines },
+        { "expressions", expression_lines },
+    };
+
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        if (!run_corpus(corpora[i].name, corpora[i].lines, count, reps)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+/* symbol_bench.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/symbol.h"
+
+// Symbol table microbenchmark: looks names up in a table of many globals,
+// and runs many short block scopes that declare and use a few locals, once
+// with the hash table (lookup_symbol) and once with the linear scan it
+// replaced (lookup_symbol_linear), and reports the time per lookup.
+//
+// Usage: symbol-bench [globals] [lookups]
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef Symbol* (*LookupFunction)(SymbolTable* table, Atom atom);
+
+// Intern `count` distinct names with the given prefix
+static Atom* make_names(InternTable* atoms, const char* prefix, uint32_t count) {
+    Atom* names = malloc(count * sizeof(*names));
+    if (!names) return NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        char name[32];
+        int length = snprintf(name, sizeof(name), "%s%u", prefix, i);
+        names[i] = intern(atoms, name, length);
+    }
+    return names;
+}
+
+// Look up `lookups` globals in a scattered order; returns the symbols
+// found, so the work cannot be optimized away
+static uint32_t lookup_globals(SymbolTable* table, LookupFunction lookup, const Atom* globals,
+                               uint32_t count, uint32_t lookups) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < lookups; i++) {
+        found += lookup(table, globals[(i * 7919u) % count]) != NULL;
+    }
+    return found;
+}
+
+// Blocks that each declare `locals` names, use every local and one
+// global, then close
+static uint32_t run_blocks(SymbolTable* table, LookupFunction lookup, const Atom* globals, uint32_t count,
+                           const Atom* locals, uint32_t local_count, uint32_t blocks) {
+    uint32_t found = 0;
+    for (uint32_t b = 0; b < blocks; b++) {
+        enter_scope(table);
+        for (uint32_t i = 0; i < local_count; i++) {
+            add_symbol(table, locals[i], TYPE_INT, 1, AST_NO_NODE);
+        }
+        for (uint32_t i = 0; i < local_count; i++) {
+            found += lookup(table, locals[i]) != NULL;
+        }
+        found += lookup(table, globals[(b * 7919u) % count]) != NULL;
+        exit_scope(table);
+    }
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t global_count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 10000;
+    uint32_t lookups = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 100000;
+    const uint32_t local_count = 8;
+    if (global_count == 0) global_count = 1;
+
+    InternTable atoms;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error for the benchmark\n");
+        return 1;
+    }
+    Atom* globals = make_names(&atoms, "global_", global_count);
+    Atom* locals = make_names(&atoms, "local_", local_count);
+    SymbolTable* table = init_symbol_table(&atoms, NULL);
+    if (!globals || !locals || !table) {
+        fprintf(stderr, "Memory allocation error for the benchmark\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < global_count; i++) {
+        add_symbol(table, globals[i], TYPE_INT, 1, AST_NO_NODE);
+    }
+    // Both lookups must agree on every name, shadowed ones included
+    enter_scope(table);
+    add_symbol(table, globals[0], TYPE_FLOAT, 2, AST_NO_NODE);
+    for (uint32_t i = 0; i < global_count; i++) {
+        if (lookup_symbol(table, globals[i]) != lookup_symbol_linear(table, globals[i])) {
+            fprintf(stderr, "Lookups disagree on global %u\n", i);
+            return 1;
+        }
+    }
+    exit_scope(table);
+
+    printf("%u globals, %u lookups, blocks of %u locals\n", global_count, lookups, local_count);
+    struct { const char* name; LookupFunction lookup; } variants[] = {
+        { "hash table ", lookup_symbol },
+        { "linear scan", lookup_symbol_linear },
+    };
+    uint32_t blocks = lookups / (local_count + 1);
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        double start = now_seconds();
+        uint32_t found = lookup_globals(table, variants[v].lookup, globals, global_count, lookups);
+        double middle = now_seconds();
+        found += run_blocks(table, variants[v].lookup, globals, global_count, locals, local_count, blocks);
+        double end = now_seconds();
+        printf("  %s  globals %8.1f ns/lookup  blocks %8.1f ns/lookup  (%u found)\n", variants[v].name,
+               (middle - start) * 1e9 / lookups, (end - middle) * 1e9 / (blocks * (local_count + 1.0)), found);
+    }
+
+    free_symbol_table(table);
+    free(globals);
+    free(locals);
+    intern_free(&atoms);
+    return 0;
+}
@@ -0,0 +1,36 @@
+/* arena.h */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator over a chain of large blocks. Allocations are never freed
+// individually; the whole arena is released at once. Pointers stay valid
+// until the arena is reset or freed. A reset arena keeps its blocks and
+// refills them, so a long-running process can reuse one arena per job.
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;   // Previously filled block
+    size_t size;               // Usable bytes in data[]
+    size_t used;               // Bytes handed out so far
+    unsigned char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;          // Block currently being filled
+    ArenaBlock* first;         // Oldest block in the head chain
+    ArenaBlock* spare;         // Emptied blocks waiting to be refilled
+    size_t block_size;         // Default size of new blocks
+} Arena;
+
+void arena_init(Arena* arena, size_t block_size);
+// Allocate `size` bytes aligned for any object type; NULL if out of memory
+void* arena_alloc(Arena* arena, size_t size);
+// Allocate `size` bytes aligned to `align` (a power of two)
+void* arena_alloc_aligned(Arena* arena, size_t size, size_t align);
+// Allocate `size` bytes with no alignment requirement (e.g. string bytes)
+void* arena_alloc_bytes(Arena* arena, size_t size);
+// Release every allocation at once, keeping the blocks for reuse; O(1)
+void arena_reset(Arena* arena);
+void arena_free(Arena* arena);
+
+#endif /* ARENA_H */
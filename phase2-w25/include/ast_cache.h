@@ -0,0 +1,48 @@
+/* ast_cache.h */
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "intern.h"
+#include "parser.h"
+#include "sink.h"
+
+// On-disk cache of parse results, one file per source text named by its
+// content hash (<dir>/<16 hex digits>.ast). A cache file is an image of
+// the flat AST: a header, the node pool and child edges exactly as they
+// are laid out in memory, the spellings and decoded values of the atoms
+// the nodes refer to, and the rendered parse diagnostics. Every reference
+// inside it is an index or a file offset, so a hit is mapped read-only and
+// the tree is used in place; only the atoms are interned again.
+//
+// Images are only read back by a build with the same node layout, byte
+// order and PARSER_REVISION, and only once every index in them has been
+// checked; anything else, like a file of the wrong size or a child
+// reference past the edge list, is a miss.
+typedef struct {
+    Ast ast;                    // Points into the mapping; read-only
+    const char* diagnostics;    // Parse errors, one per line ("" if none)
+    int error_count;
+    void* map;
+    size_t map_size;
+} AstImage;
+
+// Look up the image for a source text of `size` bytes with hash `hash`.
+// On a hit, maps it into `image`, interns its atoms into `atoms` (which
+// must hold only the predefined atoms) and returns 1; returns 0 on a miss.
+int ast_cache_load(AstImage* image, const char* dir, uint64_t hash, size_t size, InternTable* atoms);
+void ast_image_close(AstImage* image);
+
+// Store the result of parsing a source text of `size` bytes. The file is
+// written under a temporary name and renamed into place, so concurrent
+// runs never see a partial image. Returns 0 if it could not be written.
+int ast_cache_store(const char* dir, uint64_t hash, size_t size, const Ast* ast,
+                    const InternTable* atoms, const char* diagnostics, int error_count);
+// Write the image of a parse result to `out` and flush it; returns 0 if
+// it could not be written. This is the cache file's format.
+int ast_image_write(Sink* out, uint64_t hash, size_t size, const Ast* ast,
+                    const InternTable* atoms, const char* diagnostics, int error_count);
+
+#endif /* AST_CACHE_H */
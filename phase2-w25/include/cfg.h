@@ -0,0 +1,72 @@
+/* cfg.h */
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdint.h>
+
+#include "parser.h"
+#include "symbol.h"
+
+// Control-flow graph of a program, built from its tree after names were
+// resolved. A basic block is a run of events that always happen together,
+// in the order they happen; if, while and repeat split the program into
+// blocks. Blocks are numbered in the order control first reaches them, a
+// reverse postorder of the graph: every edge goes to a higher-numbered
+// block, except the edge back to the start of a loop.
+typedef uint32_t BlockId;
+#define CFG_NO_BLOCK UINT32_MAX
+
+// What an event does with its variable
+typedef enum {
+    CFG_DECLARE,        // AST_VARDECL: a fresh, unassigned variable
+    CFG_USE,            // AST_IDENTIFIER: its value is read
+    CFG_ASSIGN          // AST_ASSIGN: a value is stored in it
+} CfgEventKind;
+
+// Variables are named by slot: the number of variables visible where the
+// variable is declared, which is also its index in the symbol table's
+// scope stack. A slot is reused once the variable's scope has closed, so
+// slots only run up to the most variables visible at once, and a slot's
+// earlier variables are gone by the time its declaration is reached.
+typedef struct {
+    NodeId node;
+    uint32_t slot;
+    uint8_t kind;               // CfgEventKind
+} CfgEvent;
+
+typedef struct {
+    uint32_t first_event;       // Events are cfg->events[first_event, + event_count)
+    uint32_t event_count;
+    uint32_t first_successor;   // Successors are cfg->edges[first_successor, + successor_count)
+    uint32_t successor_count;
+    uint32_t first_predecessor; // Same for predecessors
+    uint32_t predecessor_count;
+} BasicBlock;
+
+typedef struct {
+    BasicBlock* blocks;
+    uint32_t block_count;
+    CfgEvent* events;
+    uint32_t event_count;
+    BlockId* edges;             // Successor lists, then predecessor lists
+    uint32_t edge_count;        // Edges in the graph; each is listed twice
+    uint32_t slot_count;        // One past the highest slot
+    BlockId entry;              // Where the program starts: block 0
+    BlockId exit;               // Where it ends
+} Cfg;
+
+// Build the graph of the program at ast->root. Only variables resolution
+// declared get events: undeclared names and repeated declarations have
+// none. Returns 0 if memory ran out.
+int cfg_build(Cfg* cfg, const Ast* ast, const Resolution* resolution);
+void cfg_free(Cfg* cfg);
+
+static inline const BlockId* cfg_successors(const Cfg* cfg, BlockId block) {
+    return cfg->edges + cfg->blocks[block].first_successor;
+}
+
+static inline const BlockId* cfg_predecessors(const Cfg* cfg, BlockId block) {
+    return cfg->edges + cfg->blocks[block].first_predecessor;
+}
+
+#endif /* CFG_H */
@@ -0,0 +1,87 @@
+/* dataflow.h */
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <stdint.h>
+
+#include "cfg.h"
+
+// Bitvector dataflow over a control-flow graph. A fact is one bit per
+// variable slot, packed 64 to a word; each block has a set on entry and
+// one on exit. Sets are as wide as the most variables visible at once
+// (see cfg.h), not the number of variables in the program.
+#define DATAFLOW_WORD_BITS 64
+#define DATAFLOW_WORDS(bits) (((bits) + DATAFLOW_WORD_BITS - 1) / DATAFLOW_WORD_BITS)
+
+static inline int bitset_test(const uint64_t* set, uint32_t bit) {
+    return (set[bit / DATAFLOW_WORD_BITS] >> (bit % DATAFLOW_WORD_BITS)) & 1;
+}
+
+static inline void bitset_set(uint64_t* set, uint32_t bit) {
+    set[bit / DATAFLOW_WORD_BITS] |= (uint64_t)1 << (bit % DATAFLOW_WORD_BITS);
+}
+
+static inline void bitset_clear(uint64_t* set, uint32_t bit) {
+    set[bit / DATAFLOW_WORD_BITS] &= ~((uint64_t)1 << (bit % DATAFLOW_WORD_BITS));
+}
+
+typedef enum {
+    DATAFLOW_FORWARD,           // Facts flow from a block's entry to its exit
+    DATAFLOW_BACKWARD           // From its exit back to its entry
+} DataflowDirection;
+
+typedef enum {
+    DATAFLOW_UNION,             // A fact holds if it holds on some path
+    DATAFLOW_INTERSECTION       // Only if it holds on every path
+} DataflowMeet;
+
+// Apply a block's events to `set`, in flow order: first to last event
+// going forward, last to first going backward
+typedef void (*DataflowTransfer)(const Cfg* cfg, BlockId block, uint64_t* set, void* context);
+
+typedef struct {
+    DataflowDirection direction;
+    DataflowMeet meet;
+    DataflowTransfer transfer;
+    void* context;
+} DataflowProblem;
+
+// The solution: for each block, the facts on entry (`in`) and on exit
+// (`out`), `words` words per set
+typedef struct {
+    uint32_t words;
+    uint64_t* in;
+    uint64_t* out;
+} DataflowSets;
+
+static inline uint64_t* dataflow_in(const DataflowSets* sets, BlockId block) {
+    return sets->in + (size_t)block * sets->words;
+}
+
+static inline uint64_t* dataflow_out(const DataflowSets* sets, BlockId block) {
+    return sets->out + (size_t)block * sets->words;
+}
+
+// Solve `problem` with a worklist that visits blocks in reverse postorder
+// (postorder going backward), so facts settle in a pass over the program
+// plus one per loop they travel around. No facts hold where the program
+// starts (forward) or ends (backward). Returns 0 if memory ran out.
+int dataflow_solve(const Cfg* cfg, const DataflowProblem* problem, DataflowSets* sets);
+void dataflow_free(DataflowSets* sets);
+
+// Definite assignment (forward, intersection): a variable is assigned
+// where every path to it passes an assignment to it after its
+// declaration. Sets `assigned` in flags[use] for every use of a variable
+// that is assigned there. Assignments count if `defines` is set in
+// flags[assignment]. If `at_exit` is not NULL, it receives the slots
+// assigned where the program ends (DATAFLOW_WORDS(cfg->slot_count)
+// words). Returns 0 if memory ran out.
+int definite_assignment(const Cfg* cfg, uint8_t* flags, uint8_t defines, uint8_t assigned, uint64_t* at_exit);
+
+// Liveness (backward, union): a variable is live where some path from
+// there reads it before it is assigned again. Sets `live` in
+// flags[assignment] for every assignment whose value may be read; the
+// others are dead stores. Returns 0 if memory ran out.
+int liveness(const Cfg* cfg, uint8_t* flags, uint8_t live);
+
+#endif /* DATAFLOW_H */
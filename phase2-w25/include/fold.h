@@ -0,0 +1,43 @@
+/* fold.h */
+#ifndef FOLD_H
+#define FOLD_H
+
+#include <stdint.h>
+
+#include "intern.h"
+#include "parser.h"
+#include "symbol.h"
+
+// Constant folding, run on a program that analyzed without errors. It
+// evaluates arithmetic and comparisons on int and float literals,
+// converts literals assigned to a variable of the other numeric type,
+// applies identities such as x * 1 and x + 0, and drops if and while
+// statements whose condition folds to false. A comparison folds to the
+// number 1 or 0, typed bool.
+//
+// The program is rebuilt rather than edited, since its tree may be a
+// read-only image mapped from the AST cache; a program where nothing
+// folds is not copied at all. The folded tree keeps the node layout of
+// parser.h. The lexemes of its nodes point into `source`: the original
+// text, followed by the text of each folded literal.
+typedef struct {
+    const Ast* ast;             // The folded program: `tree`, or the original
+    const Resolution* resolution; // As resolve_names would leave it for `ast`
+    const char* source;
+    uint32_t folded;            // Expressions replaced by a literal or an operand
+    uint32_t removed;           // Statements dropped
+    // Storage for a rebuilt program, which the fields above point into; a
+    // FoldedProgram is not to be copied
+    Ast tree;
+    Resolution names;
+    char* text;
+} FoldedProgram;
+
+// Fold the program at ast->root, whose text is `source` and whose names
+// `resolution` resolved, interning new literals into `atoms`. Returns 0
+// if memory ran out.
+int fold_constants(const Ast* ast, const char* source, const Resolution* resolution, InternTable* atoms,
+                   FoldedProgram* folded);
+void folded_program_free(FoldedProgram* folded);
+
+#endif /* FOLD_H */
@@ -0,0 +1,92 @@
+/* intern.h */
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+// An Atom is a small integer naming one distinct interned string. Two
+// lexemes are equal exactly when their atoms are equal.
+typedef uint32_t Atom;
+
+// Atoms reserved by intern_init, in this order. Keywords come first so the
+// lexer can recognise them with a single range check. The lexer gives every
+// operator token its operator atom, so the operator range doubles as the
+// operator kind the parser's precedence table is indexed by.
+enum {
+    ATOM_NONE,
+    ATOM_IF,
+    ATOM_INT,
+    ATOM_BOOL,
+    ATOM_FLOAT,
+    ATOM_CHAR,
+    ATOM_STRING,
+    ATOM_PRINT,
+    ATOM_WHILE,
+    ATOM_REPEAT,
+    ATOM_UNTIL,
+    ATOM_DO,
+    ATOM_FACTORIAL,
+    ATOM_LAST_KEYWORD = ATOM_FACTORIAL,
+    ATOM_PLUS,
+    ATOM_FIRST_OPERATOR = ATOM_PLUS,
+    ATOM_MINUS,
+    ATOM_STAR,
+    ATOM_SLASH,
+    ATOM_LT,
+    ATOM_GT,
+    ATOM_EQ,
+    ATOM_NE,
+    ATOM_LAST_OPERATOR = ATOM_NE,
+    ATOM_PREDEFINED_COUNT
+};
+
+// Value of a numeric literal, decoded once when its text is first interned
+typedef enum {
+    NUMBER_NONE,               // Not a number literal (or not decoded yet)
+    NUMBER_INT,
+    NUMBER_FLOAT,
+    NUMBER_INVALID             // Out of range
+} NumberKind;
+
+typedef struct {
+    uint8_t kind;              // NumberKind
+    union {
+        int64_t i;             // NUMBER_INT
+        double f;              // NUMBER_FLOAT
+    };
+} NumberValue;
+
+// Open-addressing hash table mapping strings to atoms. The bytes of every
+// distinct string are stored once, NUL-terminated, in an arena.
+typedef struct {
+    Arena bytes;               // Storage for the interned strings
+    const char** text;         // atom -> string
+    uint32_t* length;          // atom -> string length
+    uint32_t* hash;            // atom -> hash, kept for rehashing
+    NumberValue* numbers;      // atom -> value, for number literals
+    uint32_t count;            // Atoms in use (including ATOM_NONE)
+    uint32_t capacity;         // Allocated entries in text/length/hash
+    Atom* slots;               // Hash slots holding atoms (ATOM_NONE = empty)
+    uint32_t slot_mask;        // Number of slots - 1 (power of two)
+} InternTable;
+
+// Set up a table holding the predefined atoms; 0 if out of memory (the
+// table is then empty and needs no intern_free)
+int intern_init(InternTable* table);
+// Drop every atom but the predefined ones, keeping the memory for the
+// atoms added next; their numbers are handed out again
+void intern_reset(InternTable* table);
+// Return the atom for text[0..length), adding it if it is new
+Atom intern(InternTable* table, const char* text, size_t length);
+// Return the atom for text[0..length) without adding it (ATOM_NONE if absent)
+Atom intern_find(const InternTable* table, const char* text, size_t length);
+const char* atom_text(const InternTable* table, Atom atom);
+uint32_t atom_length(const InternTable* table, Atom atom);
+// Decoded value of a number literal's atom (kind NUMBER_NONE for other atoms)
+const NumberValue* atom_number(const InternTable* table, Atom atom);
+void intern_free(InternTable* table);
+
+#endif /* INTERN_H */
@@ -2,11 +2,119 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "tokens.h"
+#include "scan.h"
+#include "sink.h"
+
+// Tokenizer implementations; both produce identical token streams
+typedef enum {
+    LEXER_HANDWRITTEN,      // Branchy scanner built on the ScanOps run scanners
+    LEXER_DFA               // Table-driven state machine (lexer_dfa.c)
+} LexerEngine;
+
+// Lexer state for a single source buffer. Each Lexer is independent, so
+// several sources can be lexed at once (e.g. on different threads).
+typedef struct {
+    const char* source;     // NUL-terminated input being lexed
+    size_t pos;             // Offset of the next unread character
+    int line;               // Current line number (1-based)
+    size_t line_start;      // Offset of the first character of the current line
+    TokenType last_type;    // Type of the previously returned token
+    const ScanOps* scan;    // Byte-run scanners (SIMD when the CPU supports it)
+    InternTable* atoms;     // Table that identifiers and literals are interned into
+    LexerEngine engine;     // Tokenizer used by lexer_next
+    int quiet;              // Do not print warnings
+    Sink* out;              // Where warnings are printed (NULL: stdout)
+} Lexer;
+
+// A token's lexeme: a view into the source buffer (not NUL-terminated)
+typedef struct {
+    const char* text;
+    int length;
+} TokenText;
+
+// A whole token stream in struct-of-arrays form, produced by lexing the
+// input up front. Token i is (types[i], errors[i], offsets[i], ...); the
+// last token is always TOKEN_EOF.
+typedef struct {
+    uint8_t* types;         // TokenType of each token
+    uint8_t* errors;        // ErrorType of each token
+    uint32_t* offsets;      // Lexeme offsets into the source
+    uint32_t* lengths;      // Lexeme lengths
+    int* lines;             // Line numbers
+    Atom* atoms;            // Interned lexemes
+    uint32_t count;         // Tokens stored
+    uint32_t capacity;      // Tokens allocated
+} TokenBuffer;
+
+// Lexer over a file descriptor that is read in fixed-size chunks, for
+// inputs too large (or too slow to arrive) to buffer whole. Only a window
+// of the input is held in memory: about one chunk, more only while a single
+// token is longer than that. The intern table is emptied back to the
+// predefined atoms whenever the window moves on, so it only ever holds the
+// lexemes of one window. Returned tokens' offset and line fields are
+// relative to the current window; stream_lexer_next reports the absolute
+// 64-bit offset and line.
+typedef struct {
+    int fd;                 // Input being read
+    char* window;           // Buffered input, NUL-terminated at `length`
+    size_t length;          // Bytes of input in the window
+    size_t capacity;        // Bytes allocated for the window (excluding the NUL)
+    size_t chunk_size;      // Bytes requested per read
+    uint64_t base;          // Absolute input offset of window[0]
+    uint64_t line_base;     // Lines of input before the window's first line
+    int eof;                // The whole input has been read
+    int failed;             // A read or allocation failed
+    Lexer lexer;            // Lexes the window
+} StreamLexer;
+
+// Lexer functions that need to be visible to other files. Token offsets
+// are 32-bit, so `input` must be shorter than UINT32_MAX bytes; lex_all
+// checks that, lexer_next leaves it to the caller.
+void lexer_init(Lexer* lexer, const char* input, InternTable* atoms);
+Token lexer_next(Lexer* lexer);
+int lexer_column(const Lexer* lexer);
+TokenText token_text(const char* source, Token token);
+void print_token(Sink* out, const char* source, Token token);
+// Same, for a token on `line`, which may be past the range of Token.line
+void print_token_at(Sink* out, const char* source, Token token, uint64_t line);
+void print_error(Sink* out, ErrorType error, uint64_t line, TokenText lexeme);
+// Warning for a char literal longer than one character (truncated to `c`)
+void print_char_length_warning(Sink* out, char c);
+// Whether `token`, lexed from `start` in `source`, is a char literal that
+// printed that warning (or would have, if not quiet)
+int lexer_warned_char_length(const char* source, size_t start, Token token);
+// Finish a number token whose span is set: intern it and attach its value,
+// or turn it into ERROR_INVALID_NUMBER if the value does not fit
+void lexer_number(Lexer* lexer, Token* token);
+// The DFA tokenizer behind lexer_next for LEXER_DFA; it does not update last_type
+Token lexer_scan_dfa(Lexer* lexer);
+
+// Batch lexing into a TokenBuffer
+void token_buffer_init(TokenBuffer* buffer);
+// Lex everything left in `lexer` (through EOF); returns 0 if out of
+// memory or if the input is UINT32_MAX bytes or longer
+int lex_all(Lexer* lexer, TokenBuffer* buffer);
+// Same result as lex_all, with the input split at newlines into up to
+// `threads` chunks that are lexed concurrently. Inputs too small to be
+// worth splitting are lexed on the calling thread.
+int lex_all_parallel(Lexer* lexer, TokenBuffer* buffer, int threads);
+// Make room for at least `capacity` tokens; returns 0 if out of memory
+int token_buffer_reserve(TokenBuffer* buffer, uint32_t capacity);
+// Reassemble token `index`; indexes past the end yield the final EOF token
+Token token_buffer_get(const TokenBuffer* buffer, uint32_t index);
+void token_buffer_free(TokenBuffer* buffer);
 
-// Lexer functions that need to be visible to other files
-Token get_next_token(const char* input, int* pos);
-void print_token(Token token);
-void print_error(ErrorType error, int line, const char* lexeme);
+// Streaming lexing; stream_lexer_init returns 0 if out of memory. `atoms`
+// must hold only the predefined atoms.
+int stream_lexer_init(StreamLexer* stream, int fd, size_t chunk_size, InternTable* atoms);
+// Next token; its text and atom are valid until the following call. Stops
+// with TOKEN_EOF at end of input, or on a read error, on running out of
+// memory or at a single token of INT_MAX bytes or longer (check `failed`).
+Token stream_lexer_next(StreamLexer* stream, uint64_t* offset, uint64_t* line);
+void stream_lexer_free(StreamLexer* stream);
 
 #endif /* LEXER_H */
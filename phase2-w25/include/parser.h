@@ -2,7 +2,11 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stdint.h>
+
 #include "tokens.h"
+#include "lexer.h"
+#include "sink.h"
 
 // Basic node types for AST
 typedef enum {
@@ -17,7 +21,6 @@ typedef enum {
     AST_IF,
     AST_WHILE,
     AST_BLOCK, 
-    AST_BLOCK_END, 
     AST_STRING,
     AST_REPEAT,
     AST_FACTORIAL,
@@ -35,24 +38,156 @@ typedef enum {
     PARSE_ERROR_INVALID_EXPRESSION,
     PARSE_ERROR_MISSING_BRACKET,
     PARSE_ERROR_MISSING_RPAREN,
-    PARSE_ERROR_MISSING_UNTIL
+    PARSE_ERROR_MISSING_UNTIL,
+    PARSE_ERROR_TOO_DEEP
 } ParseError;
 
+// Nodes live in one flat pool and refer to each other by 32-bit index.
+// Nodes are stored in post-order (children before their parent, the root
+// last), and each node's children are a contiguous range of the pool's
+// child list, in source order:
+//   AST_PROGRAM, AST_BLOCK    statements
+//   AST_VARDECL               name
+//   AST_ASSIGN                name, value
+//   AST_BINOP, AST_COMPOP     left, right
+//   AST_IF, AST_WHILE         condition, block
+//   AST_REPEAT                block, condition
+//   AST_PRINT, AST_FACTORIAL  expression
+// After a syntax error a node may have fewer children than listed.
+typedef uint32_t NodeId;
+#define AST_NO_NODE UINT32_MAX
+
 // AST Node structure
-typedef struct ASTNode {
-    ASTNodeType type;           // Type of node
-    Token token;               // Token associated with this node
-    struct ASTNode* left;      // Left child
-    struct ASTNode* right;     // Right child
-    // TODO: Add more fields if needed
+typedef struct {
+    uint8_t type;               // ASTNodeType
+    uint8_t token_type;         // TokenType of the node's token
+    uint8_t error;              // ErrorType the lexer attached to the token
+    uint32_t offset;            // The token's lexeme: source[offset, offset + length)
+    uint32_t length;
+    int line;                   // Line of the token
+    Atom atom;                  // Interned lexeme
+    uint32_t first_child;       // Children are children[first_child, first_child + child_count)
+    uint32_t child_count;
 } ASTNode;
 
-// Parser functions
-void parser_init(const char* input);
-ASTNode* parse(void);
-void print_ast(ASTNode* node, int level);
-void free_ast(ASTNode* node);
-ASTNode *parse_program(void);
-void print_ast_node(ASTNode* node);
+typedef struct {
+    ASTNode* nodes;             // Node pool, in post-order
+    uint32_t count;
+    uint32_t capacity;
+    NodeId* children;           // Child ranges of every node
+    uint32_t child_total;
+    uint32_t child_capacity;
+    NodeId root;                // AST_PROGRAM node of the last parse
+    int failed;                 // Ran out of memory while building
+} Ast;
+
+void ast_init(Ast* ast);
+// Drop every node at once, keeping the memory for the next parse
+void ast_reset(Ast* ast);
+void ast_free(Ast* ast);
+// The node's lexeme (the token text "EOF" for end of input)
+TokenText ast_text(const char* source, const ASTNode* node);
+
+// Make room for one more node with `count` children; 0 when out of memory
+int ast_grow(Ast* ast, uint32_t count);
+
+static inline ASTNode* ast_node(const Ast* ast, NodeId id) {
+    return &ast->nodes[id];
+}
+
+// Append a node for `token` with the given children; returns its index,
+// or AST_NO_NODE with ast->failed set when out of memory
+static inline NodeId ast_add(Ast* ast, ASTNodeType type, Token token, const NodeId* children, uint32_t count) {
+    if ((ast->count == ast->capacity || ast->child_total + count > ast->child_capacity)
+        && !ast_grow(ast, count)) {
+        return AST_NO_NODE;
+    }
+    NodeId id = ast->count++;
+    ASTNode* node = &ast->nodes[id];
+    node->type = type;
+    node->token_type = token.type;
+    node->error = token.error;
+    node->offset = token.offset;
+    node->length = token.length;
+    node->line = token.line;
+    node->atom = token.atom;
+    node->first_child = ast->child_total;
+    node->child_count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        ast->children[ast->child_total++] = children[i];
+    }
+    return id;
+}
+
+// Child `i` of `node`, or AST_NO_NODE if it has no such child
+static inline NodeId ast_child(const Ast* ast, NodeId id, uint32_t i) {
+    const ASTNode* node = &ast->nodes[id];
+    return i < node->child_count ? ast->children[node->first_child + i] : AST_NO_NODE;
+}
+
+// Iterative depth-first walk over the subtree at `root`, visiting children
+// in source order. `enter` runs before a node's children and may return
+// AST_WALK_SKIP to skip them; `leave` runs after them. Either may be NULL.
+// `depth` is 0 at `root`. The walk keeps its own stack on the heap, so deep
+// trees cost no C stack. Returns 0 if that stack could not be allocated.
+typedef enum {
+    AST_WALK_CONTINUE,
+    AST_WALK_SKIP
+} AstWalkAction;
+
+typedef AstWalkAction (*AstEnter)(const Ast* ast, NodeId node, uint32_t depth, void* context);
+typedef void (*AstLeave)(const Ast* ast, NodeId node, uint32_t depth, void* context);
+
+int ast_walk(const Ast* ast, NodeId root, AstEnter enter, AstLeave leave, void* context);
+
+// A parse session. It owns the token cursor, the lexer state for
+// on-demand lexing, the diagnostics and the tree, so independent sessions
+// can parse on different threads at once without locks (each needs its
+// own InternTable when lexing on demand). A session can be reused: every
+// parse replaces the previous tree and diagnostics but keeps their memory.
+typedef struct Parser Parser;
+
+// Revision of the trees and diagnostics the parser produces. Stored parse
+// results (ast_cache.h) are only reused by a parser of the same revision,
+// so bump it with any change to what a parse of some text gives.
+#define PARSER_REVISION 1
+
+Parser* parser_create(void);
+void parser_destroy(Parser* parser);
+// Parse `input`, lexing on demand and interning into `atoms`. Returns the
+// AST_PROGRAM node, or AST_NO_NODE if memory ran out. Blocks and
+// parentheses nested deeper than PARSER_MAX_DEPTH (parser.c) are reported
+// and skipped.
+NodeId parser_parse(Parser* parser, const char* input, InternTable* atoms);
+// Same, over tokens already lexed from `input`
+NodeId parser_parse_tokens(Parser* parser, const char* input, const TokenBuffer* tokens);
+// An edit of the text: `removed` bytes at `offset` were replaced by
+// `inserted` new ones
+typedef struct {
+    uint32_t offset;
+    uint32_t removed;
+    uint32_t inserted;
+} TextEdit;
+
+// Parse `input` again after `edit` changed the text of the last parse,
+// re-lexing and re-parsing only the top-level statements the edit can
+// affect and keeping the rest of the tree. `atoms` must be the table the
+// last parse interned into. The tree, node ids included, and the
+// diagnostics come out as a full parse of `input` would give them. Falls
+// back to a full parse when the last one failed.
+NodeId parser_reparse(Parser* parser, const char* input, InternTable* atoms, TextEdit edit);
+// Tree of the last parse; valid until the next parse or parser_destroy
+const Ast* parser_ast(const Parser* parser);
+// Errors of the last parse, one per line ("" if none)
+const char* parser_diagnostics(const Parser* parser);
+int parser_error_count(const Parser* parser);
+
+void print_ast(Sink* out, const char* source, const Ast* ast, NodeId node, int level);
+void print_ast_node(Sink* out, const char* source, const Ast* ast, NodeId node);
+// The subtree at `node` as one line of nested JSON objects, each
+// {"type", "line", "text", "children"}; returns 0 if out of memory
+int print_ast_json(Sink* out, const char* source, const Ast* ast, NodeId node);
+// `text` as a quoted JSON string
+void json_write_string(Sink* out, const char* text, size_t length);
 
 #endif /* PARSER_H */
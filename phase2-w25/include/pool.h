@@ -0,0 +1,19 @@
+/* pool.h */
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+
+// Runs one task of a pool_run batch; tasks of a batch may run at the same
+// time on different threads, so shared state needs its own locking
+typedef void (*PoolTask)(uint32_t task, void* context);
+
+// Run tasks 0 to count - 1 on a work-stealing pool of `threads` threads,
+// the calling thread among them, and return when all have run. Thread i
+// starts on tasks i, i + threads, i + 2 * threads, ... in that order, so
+// low-numbered tasks tend to finish first; a thread that runs out steals
+// the last task left to another. If a thread cannot be started, the others
+// take its tasks.
+void pool_run(int threads, uint32_t count, PoolTask run, void* context);
+
+#endif /* POOL_H */
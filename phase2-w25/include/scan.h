@@ -0,0 +1,41 @@
+/* scan.h */
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+// Byte-run scanners used by the lexer's hot loops. Every scanner starts at
+// `pos` in a NUL-terminated buffer and returns the offset of the first byte
+// that does not belong to the run (the NUL terminator always ends a run).
+// Scanners that can cross newlines add the number of '\n' bytes they
+// consumed to *lines and set *line_start to the offset just past the last one.
+typedef struct {
+    const char* name;
+    size_t (*skip_space)(const char* s, size_t pos, int* lines, size_t* line_start);
+    size_t (*skip_ident)(const char* s, size_t pos);
+    size_t (*skip_digits)(const char* s, size_t pos);
+    size_t (*skip_quoted)(const char* s, size_t pos, char quote, int* lines, size_t* line_start);
+} ScanOps;
+
+// Portable byte-at-a-time implementation, always available
+const ScanOps* scan_ops_scalar(void);
+// Vector implementations; NULL when the running CPU lacks the instructions
+const ScanOps* scan_ops_sse2(void);
+const ScanOps* scan_ops_avx2(void);
+// Fastest implementation supported by the running CPU
+const ScanOps* scan_ops_best(void);
+
+// Locale-independent ASCII classification used instead of <ctype.h>
+static inline int scan_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline int scan_is_ident_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline int scan_is_ident(char c) {
+    return scan_is_ident_start(c) || scan_is_digit(c);
+}
+
+#endif /* SCAN_H */
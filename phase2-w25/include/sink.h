@@ -0,0 +1,40 @@
+/* sink.h */
+#ifndef SINK_H
+#define SINK_H
+
+#include <stddef.h>
+
+#define SINK_BUFFER_SIZE (64 * 1024)
+// The descriptor of a sink that keeps its output in memory
+#define SINK_MEMORY (-1)
+
+// Buffered output to a file descriptor. Messages are collected in memory
+// and written out a buffer at a time, so printing many short lines costs a
+// few large writes. A memory sink never writes: its buffer grows to hold
+// everything, for the caller to pass on later. Every function also accepts
+// a NULL sink, which writes straight to stdout.
+typedef struct {
+    int fd;                     // SINK_MEMORY for a memory sink
+    char* buffer;
+    size_t length;              // Bytes waiting in the buffer
+    size_t capacity;
+    int failed;                 // A write failed; later output is dropped
+} Sink;
+
+// Returns 0 if out of memory
+int sink_init(Sink* sink, int fd);
+// A sink that collects `buffer[0, length)` in memory; returns 0 if out of
+// memory
+int sink_init_memory(Sink* sink);
+void sink_write(Sink* sink, const char* text, size_t length);
+void sink_puts(Sink* sink, const char* text);
+void sink_printf(Sink* sink, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+// Write out everything buffered (nothing, for a memory sink); returns 0 if
+// any write has failed
+int sink_flush(Sink* sink);
+// Flush and release the buffer (the descriptor stays open); returns 0 if
+// any write has failed. A memory sink's output is dropped with it.
+int sink_close(Sink* sink);
+
+#endif /* SINK_H */
@@ -0,0 +1,29 @@
+/* source.h */
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A source file loaded for lexing. `data` is always NUL-terminated.
+// Regular files are memory-mapped read-only (zero-copy); pipes and other
+// unmappable inputs are read into a heap buffer instead.
+typedef struct {
+    const char* data;       // File contents followed by a NUL byte
+    size_t size;            // Length of the contents, excluding the NUL
+    void* map;              // Base of the mapping, or NULL if read into memory
+    size_t map_size;        // Length of the mapping
+} SourceFile;
+
+// Largest input that can be loaded: tokens and tree nodes hold 32-bit
+// offsets into it, up to the EOF token's at its end
+#define SOURCE_MAX_SIZE ((size_t)UINT32_MAX - 1)
+
+// Load `path` ("-" for stdin); returns 0 on success, -1 with errno set
+// otherwise (EFBIG for an input larger than SOURCE_MAX_SIZE)
+int source_open(SourceFile* source, const char* path);
+void source_close(SourceFile* source);
+// 64-bit hash of the contents, for keying caches by content
+uint64_t source_hash(const SourceFile* source);
+
+#endif /* SOURCE_H */
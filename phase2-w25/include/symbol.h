@@ -2,34 +2,69 @@
 #define SYMBOL_H
 
 #include "semantic.h"
+#include "sink.h"
 
-typedef struct Symbol {
-    char name[100];          // Variable name
-    VarType type;            // Data type (int, etc.)
+// Index of a symbol in its table's pool
+typedef uint32_t SymbolId;
+#define SYMBOL_NONE UINT32_MAX
+
+// A declaration. Its name is not copied: the atom's text in the intern
+// table is the name.
+typedef struct {
+    Atom atom;               // Interned name, used for lookups
+    uint8_t type;            // VarType: data type (int, etc.)
+    uint8_t is_initialized;  // Has been assigned a value?
     int scope_level;         // Scope nesting level
     int line_declared;       // Line where declared
-    int is_initialized;      // Has been assigned a value?
-    struct Symbol* next;     // For linked list implementation
+    SymbolId shadowed;       // Declaration of the same name this one hides
+    NodeId declaration;      // Its AST_VARDECL node
 } Symbol;
 
-// Symbol table
+// A name's hash slot: the innermost visible declaration of `atom`
+// (SYMBOL_NONE once every declaration of it has gone out of scope)
 typedef struct {
-    Symbol* last_symbol;            
+    Atom atom;               // ATOM_NONE = empty
+    SymbolId symbol;
+} SymbolSlot;
+
+// Symbol table. The visible symbols sit in one array used as a stack, in
+// declaration order, so the symbols of a scope are the top of the stack
+// from where it began; each open scope records that watermark, and
+// closing it pops back to it. Lookups go through an open-addressing hash
+// table keyed by the interned name, where each name leads to its innermost
+// declaration and that to the ones it shadows.
+typedef struct {
+    Symbol* symbols;         // Stack of visible symbols
+    uint32_t symbol_count;
+    uint32_t symbol_capacity;
+    uint32_t* scope_marks;   // scope_marks[level - 1]: symbol_count when `level` was entered
+    uint32_t mark_capacity;
     int current_scope;       // Current scope level
+    const InternTable* atoms; // Names of the atoms symbols are keyed by
+    Sink* out;               // Where semantic errors are reported
+    SymbolSlot* slots;
+    uint32_t slot_mask;      // Number of slots - 1 (power of two)
+    uint32_t slot_count;     // Slots in use
 } SymbolTable;
 
 // Initialize a new symbol table
 // Creates an empty symbol table structure with scope level set to 0
-SymbolTable* init_symbol_table(void);
+// Returns NULL if out of memory
+SymbolTable* init_symbol_table(const InternTable* atoms, Sink* out);
 
 // Add a symbol to the table
 // Inserts a new variable with given name, type, and line number into the current scope
-void add_symbol(SymbolTable* table, const char* name, VarType type, int line);
+void add_symbol(SymbolTable* table, Atom atom, VarType type, int line, NodeId declaration);
 
 // Look up a symbol in the table
-// Searches for a variable by name across all accessible scopes
-// Returns the symbol if found, NULL otherwise
-Symbol* lookup_symbol(SymbolTable* table, const char* name);
+// Searches for a variable by interned name across all accessible scopes
+// Returns the symbol if found, NULL otherwise. The pointer is valid until
+// the next add_symbol.
+Symbol* lookup_symbol(SymbolTable* table, Atom atom);
+
+// Same result as lookup_symbol by scanning every visible symbol; the
+// baseline bench/symbol_bench.c measures the hash table against
+Symbol* lookup_symbol_linear(SymbolTable* table, Atom atom);
 
 // Enter a new scope level
 // Increments the current scope level when entering a block (e.g., if, while)
@@ -41,7 +76,8 @@ void enter_scope(SymbolTable* table);
 void exit_scope(SymbolTable* table);
 
 // Remove symbols from the current scope
-// Cleans up symbols that are no longer accessible after leaving a scope
+// Pops the symbol stack back to the scope's watermark, handing each name
+// back to the declaration it shadowed; nothing is freed
 void remove_symbols_in_current_scope(SymbolTable* table);
 
 // Free the symbol table memory
@@ -49,6 +85,32 @@ void remove_symbols_in_current_scope(SymbolTable* table);
 void free_symbol_table(SymbolTable* table);
 
 // Print out contents of table
-void print_table(SymbolTable* table);
+void print_table(Sink* out, SymbolTable* table);
+
+// Name of a type for messages and the table dump
+const char* get_type_name(VarType type);
+
+// What name resolution learned about a tree, indexed by NodeId. It is kept
+// beside the tree rather than in it, since the tree may be a read-only
+// image mapped from the AST cache.
+typedef struct {
+    // AST_IDENTIFIER: the AST_VARDECL it names (AST_NO_NODE if undeclared).
+    // AST_VARDECL: itself, or the earlier one it repeats in the same scope.
+    NodeId* declarations;
+    // VarType of AST_IDENTIFIER (its declared type), AST_NUMBER, AST_STRING,
+    // AST_CHAR, AST_BINOP and AST_COMPOP nodes, assuming every variable has
+    // been assigned; TYPE_ERROR for other nodes
+    uint8_t* types;
+    uint32_t count;
+} Resolution;
+
+// Resolve every name of the tree in one walk, declaring its variables in
+// `table`. Returns 0 if out of memory.
+int resolve_names(const Ast* ast, SymbolTable* table, Resolution* resolution);
+void resolution_free(Resolution* resolution);
+// Resolve names, then check declarations, assignments and expressions,
+// reporting to table->out. Returns the number of errors. Afterwards the
+// table holds the global variables, and `resolution` the tree's names.
+int analyze_semantics(const Ast* ast, SymbolTable* table, Resolution* resolution);
 
 #endif
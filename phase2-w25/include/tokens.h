@@ -2,6 +2,8 @@
 #ifndef TOKENS_H
 #define TOKENS_H
 
+#include "intern.h"
+
 typedef enum {
     TOKEN_EOF,
     TOKEN_NUMBER,      // e.g., "123", "456"
@@ -39,11 +41,14 @@ typedef enum {
     ERROR_UNEXPECTED_TOKEN
 } ErrorType;
 
+// Tokens don't own their text: the lexeme is source[offset, offset + length)
 typedef struct {
-    TokenType type;
-    char lexeme[100];   // Actual text of the token
+    uint8_t type;       // TokenType
+    uint8_t error;      // ErrorType, if any
+    uint32_t offset;    // Byte offset of the lexeme in the source
+    uint32_t length;    // Length of the lexeme in bytes
     int line;           // Line number in source file
-    ErrorType error;    // Error type if any
+    Atom atom;          // Interned lexeme (ATOM_NONE for punctuation)
 } Token;
 
 #endif /* TOKENS_H */
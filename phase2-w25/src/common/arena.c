@@ -0,0 +1,98 @@
+/* arena.c */
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stdint.h>
+
+#include "../../include/arena.h"
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+void arena_init(Arena* arena, size_t block_size) {
+    arena->head = NULL;
+    arena->first = NULL;
+    arena->spare = NULL;
+    arena->block_size = block_size;
+}
+
+// Start a new block large enough for `size` bytes at any `align` boundary,
+// reusing a spare block when the next one is big enough
+static ArenaBlock* arena_grow(Arena* arena, size_t size, size_t align) {
+    // Padding before an aligned start is at most align - 1 bytes
+    if (size > SIZE_MAX - align) return NULL;
+    size_t needed = size + align - 1;
+    size_t block_size = arena->block_size;
+    if (needed > block_size) block_size = needed;
+
+    ArenaBlock* block = arena->spare;
+    if (block && block->size >= block_size) {
+        arena->spare = block->next;
+    } else {
+        block = malloc(sizeof(ArenaBlock) + block_size);
+        if (!block) return NULL;
+        block->size = block_size;
+    }
+    block->used = 0;
+    block->next = arena->head;
+    if (!arena->head) arena->first = block;
+    arena->head = block;
+    return block;
+}
+
+// Carve `size` bytes at an `align` boundary out of `block`; NULL if they
+// do not fit in what is left of it
+static void* block_take(ArenaBlock* block, size_t size, size_t align) {
+    uintptr_t start = (uintptr_t)(block->data + block->used);
+    size_t padding = (align - (start & (align - 1))) & (align - 1);
+    size_t left = block->size - block->used;
+    if (padding > left || size > left - padding) return NULL;
+    block->used += padding + size;
+    return (void*)(start + padding);
+}
+
+static void* arena_take(Arena* arena, size_t size, size_t align) {
+    if (arena->head) {
+        void* p = block_take(arena->head, size, align);
+        if (p) return p;
+    }
+
+    ArenaBlock* block = arena_grow(arena, size, align);
+    if (!block) return NULL;
+    return block_take(block, size, align);
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    return arena_take(arena, size, ARENA_ALIGN);
+}
+
+void* arena_alloc_aligned(Arena* arena, size_t size, size_t align) {
+    return arena_take(arena, size, align);
+}
+
+void* arena_alloc_bytes(Arena* arena, size_t size) {
+    return arena_take(arena, size, 1);
+}
+
+void arena_reset(Arena* arena) {
+    if (!arena->head) return;
+    // The oldest block links to the spares; the newest becomes the first spare
+    arena->first->next = arena->spare;
+    arena->spare = arena->head;
+    arena->head = NULL;
+    arena->first = NULL;
+}
+
+static void free_chain(ArenaBlock* block) {
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+void arena_free(Arena* arena) {
+    free_chain(arena->head);
+    free_chain(arena->spare);
+    arena->head = NULL;
+    arena->first = NULL;
+    arena->spare = NULL;
+}
@@ -0,0 +1,95 @@
+/* pool.c */
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "../../include/pool.h"
+
+// Each thread owns a queue of tasks, kept as a range of positions in its
+// stride through the batch: position k is task `owner + k * threads`. The
+// owner takes from the front and thieves take from the back, each under
+// the queue's lock. Tasks are whole files, so a lock per take costs
+// nothing next to the task, and no new tasks appear once a batch starts,
+// so a thread that finds every queue empty is done.
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t next;              // Position of the owner's next task
+    uint32_t end;               // One past the position of its last task
+} TaskQueue;
+
+typedef struct {
+    TaskQueue* queues;
+    int threads;
+    PoolTask run;
+    void* context;
+} Pool;
+
+typedef struct {
+    Pool* pool;
+    int index;
+    pthread_t thread;
+    int started;                // `thread` is running and must be joined
+} Worker;
+
+// Take the owner's next task, or with `steal` the last one; returns 0 if
+// the queue is empty
+static int take_task(Pool* pool, int owner, int steal, uint32_t* task) {
+    TaskQueue* queue = &pool->queues[owner];
+    int taken = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->next < queue->end) {
+        uint32_t position = steal ? --queue->end : queue->next++;
+        *task = owner + position * (uint32_t)pool->threads;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return taken;
+}
+
+static void* worker_main(void* argument) {
+    Worker* worker = argument;
+    Pool* pool = worker->pool;
+    uint32_t task;
+    for (;;) {
+        int found = take_task(pool, worker->index, 0, &task);
+        for (int i = 1; i < pool->threads && !found; i++) {
+            found = take_task(pool, (worker->index + i) % pool->threads, 1, &task);
+        }
+        if (!found) return NULL;
+        pool->run(task, pool->context);
+    }
+}
+
+void pool_run(int threads, uint32_t count, PoolTask run, void* context) {
+    if (threads > (int)count) threads = (int)count;
+    if (threads < 1) threads = 1;
+    TaskQueue* queues = malloc(threads * sizeof(*queues));
+    Worker* workers = malloc(threads * sizeof(*workers));
+    if (!queues || !workers) {
+        // Out of memory: run the batch on this thread
+        free(queues);
+        free(workers);
+        for (uint32_t task = 0; task < count; task++) run(task, context);
+        return;
+    }
+
+    Pool pool = {queues, threads, run, context};
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&queues[i].lock, NULL);
+        queues[i].next = 0;
+        queues[i].end = (uint32_t)i < count ? (count - i - 1) / threads + 1 : 0;
+        workers[i].pool = &pool;
+        workers[i].index = i;
+    }
+    // Thread 0 is this one
+    for (int i = 1; i < threads; i++) {
+        workers[i].started = pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) == 0;
+    }
+    worker_main(&workers[0]);
+    for (int i = 1; i < threads; i++) {
+        if (workers[i].started) pthread_join(workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < threads; i++) pthread_mutex_destroy(&queues[i].lock);
+    free(queues);
+    free(workers);
+}
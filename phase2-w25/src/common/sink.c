@@ -0,0 +1,136 @@
+/* sink.c */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../include/sink.h"
+
+int sink_init(Sink* sink, int fd) {
+    sink->fd = fd;
+    sink->buffer = malloc(SINK_BUFFER_SIZE);
+    sink->length = 0;
+    sink->capacity = SINK_BUFFER_SIZE;
+    sink->failed = 0;
+    return sink->buffer != NULL;
+}
+
+int sink_init_memory(Sink* sink) {
+    return sink_init(sink, SINK_MEMORY);
+}
+
+// Grow a memory sink's buffer to take `length` more bytes; returns 0 (and
+// fails the sink) if out of memory
+static int reserve(Sink* sink, size_t length) {
+    if (length <= sink->capacity - sink->length) return 1;
+    size_t capacity = sink->capacity * 2;
+    while (capacity - sink->length < length) capacity *= 2;
+    char* buffer = realloc(sink->buffer, capacity);
+    if (!buffer) {
+        sink->failed = 1;
+        return 0;
+    }
+    sink->buffer = buffer;
+    sink->capacity = capacity;
+    return 1;
+}
+
+// Write all of `text`, retrying short and interrupted writes
+static void write_all(Sink* sink, const char* text, size_t length) {
+    while (length > 0 && !sink->failed) {
+        ssize_t written = write(sink->fd, text, length);
+        if (written < 0) {
+            if (errno != EINTR) sink->failed = 1;
+            continue;
+        }
+        text += written;
+        length -= (size_t)written;
+    }
+}
+
+int sink_flush(Sink* sink) {
+    if (!sink) return fflush(stdout) == 0;
+    if (sink->fd == SINK_MEMORY) return !sink->failed;
+    write_all(sink, sink->buffer, sink->length);
+    sink->length = 0;
+    return !sink->failed;
+}
+
+void sink_write(Sink* sink, const char* text, size_t length) {
+    if (length == 0) return;
+    if (!sink) {
+        fwrite(text, 1, length, stdout);
+        return;
+    }
+    if (sink->fd == SINK_MEMORY) {
+        if (sink->failed || !reserve(sink, length)) return;
+    } else if (length > SINK_BUFFER_SIZE - sink->length) {
+        sink_flush(sink);
+        // Too large to be worth copying
+        if (length >= SINK_BUFFER_SIZE) {
+            write_all(sink, text, length);
+            return;
+        }
+    }
+    memcpy(sink->buffer + sink->length, text, length);
+    sink->length += length;
+}
+
+void sink_puts(Sink* sink, const char* text) {
+    sink_write(sink, text, strlen(text));
+}
+
+void sink_printf(Sink* sink, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!sink) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+    size_t space = sink->capacity - sink->length;
+    int length = vsnprintf(sink->buffer + sink->length, space, format, args);
+    va_end(args);
+    if (length < 0) return;
+    if ((size_t)length < space) {
+        sink->length += length;
+        return;
+    }
+
+    // It did not fit: format it again into a memory sink's grown buffer
+    if (sink->fd == SINK_MEMORY) {
+        if (sink->failed || !reserve(sink, (size_t)length + 1)) return;
+        va_start(args, format);
+        vsnprintf(sink->buffer + sink->length, (size_t)length + 1, format, args);
+        va_end(args);
+        sink->length += length;
+        return;
+    }
+    // Or into an empty buffer, or into a buffer of its own if it is
+    // larger than that
+    sink_flush(sink);
+    char* text = (size_t)length < SINK_BUFFER_SIZE ? sink->buffer : malloc((size_t)length + 1);
+    if (!text) {
+        sink->failed = 1;
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(text, (size_t)length + 1, format, args);
+    va_end(args);
+    if (text == sink->buffer) {
+        sink->length = length;
+    } else {
+        write_all(sink, text, length);
+        free(text);
+    }
+}
+
+int sink_close(Sink* sink) {
+    if (!sink) return sink_flush(sink);
+    int flushed = sink_flush(sink);
+    free(sink->buffer);
+    sink->buffer = NULL;
+    return flushed;
+}
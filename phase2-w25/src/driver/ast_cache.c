@@ -0,0 +1,244 @@
+/* ast_cache.c */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../include/ast_cache.h"
+
+#define AST_IMAGE_VERSION 2
+// Reads back as a different number on a machine of the other byte order
+#define AST_IMAGE_BYTE_ORDER 0x01020304u
+
+static const char image_magic[4] = {'A', 'S', 'T', 0x1a};
+
+// Start of every image. Sections follow in this order, each at the given
+// offset from the start of the file.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_size;         // sizeof(ASTNode) of the build that wrote it
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint32_t root;
+    uint32_t atom_count;        // Atoms of the table, the predefined ones included
+    uint32_t error_count;
+    uint32_t parser_revision;   // PARSER_REVISION of the parser that wrote it
+    uint64_t nodes;             // ASTNode[node_count]
+    uint64_t edges;             // NodeId[edge_count]
+    uint64_t atoms;             // ImageAtom[atom_count - ATOM_PREDEFINED_COUNT]
+    uint64_t strings;           // Spellings of those atoms, each NUL-terminated
+    uint64_t diagnostics;       // NUL-terminated text, up to the end of the file
+    uint64_t size;
+} ImageHeader;
+
+// An atom past the predefined ones
+typedef struct {
+    uint32_t text;              // Offset of its spelling in the strings section
+    uint32_t length;
+    NumberValue number;
+} ImageAtom;
+
+static uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+// <dir>/<hash>.ast followed by `suffix`; NULL if out of memory
+static char* image_path(const char* dir, uint64_t hash, const char* suffix) {
+    size_t length = strlen(dir) + strlen(suffix) + 32;
+    char* path = malloc(length);
+    if (path) snprintf(path, length, "%s/%016llx.ast%s", dir, (unsigned long long)hash, suffix);
+    return path;
+}
+
+// Whether `count` items of `size` bytes at `offset` end by `limit`
+static int section_fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t limit) {
+    return offset <= limit && count <= (limit - offset) / size;
+}
+
+static int header_valid(const ImageHeader* header, uint64_t file_size, uint64_t hash, size_t size) {
+    if (memcmp(header->magic, image_magic, sizeof(image_magic)) != 0 ||
+        header->version != AST_IMAGE_VERSION ||
+        header->parser_revision != PARSER_REVISION ||
+        header->byte_order != AST_IMAGE_BYTE_ORDER ||
+        header->node_size != sizeof(ASTNode) ||
+        header->source_hash != hash || header->source_size != size ||
+        header->size != file_size ||
+        header->atom_count < ATOM_PREDEFINED_COUNT ||
+        header->root >= header->node_count) {
+        return 0;
+    }
+    return section_fits(header->nodes, header->node_count, sizeof(ASTNode), header->edges) &&
+           section_fits(header->edges, header->edge_count, sizeof(NodeId), header->atoms) &&
+           header->atoms % 8 == 0 &&
+           section_fits(header->atoms, header->atom_count - ATOM_PREDEFINED_COUNT, sizeof(ImageAtom), header->strings) &&
+           header->strings <= header->diagnostics && header->diagnostics < file_size;
+}
+
+// Whether every reference in the node pool stays inside the image and the
+// source text, so that a damaged file cannot send a walk out of bounds:
+// children are in the edge list and come before their parent, as a parse
+// emits them, atoms are in the table and the enums are in range.
+static int nodes_valid(const ImageHeader* header, const char* map) {
+    const ASTNode* nodes = (const ASTNode*)(map + header->nodes);
+    const NodeId* edges = (const NodeId*)(map + header->edges);
+    for (NodeId id = 0; id < header->node_count; id++) {
+        const ASTNode* node = &nodes[id];
+        if (node->type > AST_CHAR || node->token_type > TOKEN_STRING ||
+            node->error > ERROR_UNEXPECTED_TOKEN || node->atom >= header->atom_count ||
+            node->offset > header->source_size || node->length > header->source_size - node->offset ||
+            node->first_child > header->edge_count ||
+            node->child_count > header->edge_count - node->first_child) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < node->child_count; i++) {
+            if (edges[node->first_child + i] >= id) return 0;
+        }
+    }
+    return nodes[header->root].type == AST_PROGRAM;
+}
+
+int ast_cache_load(AstImage* image, const char* dir, uint64_t hash, size_t size, InternTable* atoms) {
+    char* path = image_path(dir, hash, "");
+    if (!path) return 0;
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ImageHeader)) {
+        close(fd);
+        return 0;
+    }
+    size_t map_size = (size_t)st.st_size;
+    char* map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const ImageHeader* header = (const ImageHeader*)map;
+    if (!header_valid(header, map_size, hash, size) || map[map_size - 1] != '\0' ||
+        !nodes_valid(header, map)) {
+        munmap(map, map_size);
+        return 0;
+    }
+
+    // Atoms get their ids in order, so interning the spellings into a
+    // fresh table gives every atom its id from the image again
+    const ImageAtom* entries = (const ImageAtom*)(map + header->atoms);
+    const char* strings = map + header->strings;
+    uint64_t strings_size = header->diagnostics - header->strings;
+    for (Atom atom = ATOM_PREDEFINED_COUNT; atom < header->atom_count; atom++) {
+        const ImageAtom* entry = &entries[atom - ATOM_PREDEFINED_COUNT];
+        if ((uint64_t)entry->text + entry->length >= strings_size ||
+            intern(atoms, strings + entry->text, entry->length) != atom) {
+            munmap(map, map_size);
+            return 0;
+        }
+        atoms->numbers[atom] = entry->number;
+    }
+
+    image->ast.nodes = (ASTNode*)(map + header->nodes);
+    image->ast.count = header->node_count;
+    image->ast.capacity = header->node_count;
+    image->ast.children = (NodeId*)(map + header->edges);
+    image->ast.child_total = header->edge_count;
+    image->ast.child_capacity = header->edge_count;
+    image->ast.root = header->root;
+    image->ast.failed = 0;
+    image->diagnostics = map + header->diagnostics;
+    image->error_count = (int)header->error_count;
+    image->map = map;
+    image->map_size = map_size;
+    return 1;
+}
+
+void ast_image_close(AstImage* image) {
+    if (image->map) munmap(image->map, image->map_size);
+    image->map = NULL;
+}
+
+// Write zero bytes from `offset` up to `end`
+static void pad(Sink* out, uint64_t offset, uint64_t end) {
+    static const char zeros[8];
+    sink_write(out, zeros, end - offset);
+}
+
+int ast_image_write(Sink* out, uint64_t hash, size_t size, const Ast* ast,
+                    const InternTable* atoms, const char* diagnostics, int error_count) {
+    uint32_t extra_atoms = atoms->count - ATOM_PREDEFINED_COUNT;
+    uint64_t strings_size = 0;
+    for (Atom atom = ATOM_PREDEFINED_COUNT; atom < atoms->count; atom++) {
+        strings_size += atom_length(atoms, atom) + 1;
+    }
+    if (strings_size > UINT32_MAX) return 0;
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = AST_IMAGE_VERSION;
+    header.byte_order = AST_IMAGE_BYTE_ORDER;
+    header.node_size = sizeof(ASTNode);
+    header.source_hash = hash;
+    header.source_size = size;
+    header.node_count = ast->count;
+    header.edge_count = ast->child_total;
+    header.root = ast->root;
+    header.atom_count = atoms->count;
+    header.error_count = (uint32_t)error_count;
+    header.parser_revision = PARSER_REVISION;
+    header.nodes = align8(sizeof(header));
+    header.edges = header.nodes + (uint64_t)ast->count * sizeof(ASTNode);
+    header.atoms = align8(header.edges + (uint64_t)ast->child_total * sizeof(NodeId));
+    header.strings = header.atoms + (uint64_t)extra_atoms * sizeof(ImageAtom);
+    header.diagnostics = header.strings + strings_size;
+    header.size = header.diagnostics + strlen(diagnostics) + 1;
+
+    sink_write(out, (const char*)&header, sizeof(header));
+    pad(out, sizeof(header), header.nodes);
+    sink_write(out, (const char*)ast->nodes, (size_t)ast->count * sizeof(ASTNode));
+    sink_write(out, (const char*)ast->children, (size_t)ast->child_total * sizeof(NodeId));
+    pad(out, header.edges + (uint64_t)ast->child_total * sizeof(NodeId), header.atoms);
+    uint32_t text = 0;
+    for (Atom atom = ATOM_PREDEFINED_COUNT; atom < atoms->count; atom++) {
+        ImageAtom entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.text = text;
+        entry.length = atom_length(atoms, atom);
+        entry.number = *atom_number(atoms, atom);
+        sink_write(out, (const char*)&entry, sizeof(entry));
+        text += entry.length + 1;
+    }
+    for (Atom atom = ATOM_PREDEFINED_COUNT; atom < atoms->count; atom++) {
+        sink_write(out, atom_text(atoms, atom), atom_length(atoms, atom) + 1);
+    }
+    sink_write(out, diagnostics, strlen(diagnostics) + 1);
+    return sink_flush(out);
+}
+
+int ast_cache_store(const char* dir, uint64_t hash, size_t size, const Ast* ast,
+                    const InternTable* atoms, const char* diagnostics, int error_count) {
+    char* path = image_path(dir, hash, "");
+    char* temporary = image_path(dir, hash, ".XXXXXX");
+    int fd = path && temporary ? mkstemp(temporary) : -1;
+    if (fd < 0) {
+        free(path);
+        free(temporary);
+        return 0;
+    }
+    fchmod(fd, 0644);
+    Sink out;
+    int written = sink_init(&out, fd) && ast_image_write(&out, hash, size, ast, atoms, diagnostics, error_count);
+    sink_close(&out);
+    written = close(fd) == 0 && written;
+    written = written && rename(temporary, path) == 0;
+    if (!written) unlink(temporary);
+    free(path);
+    free(temporary);
+    return written;
+}
@@ -0,0 +1,545 @@
+/* main.c */
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../../include/parser.h"
+#include "../../include/lexer.h"
+#include "../../include/symbol.h"
+#include "../../include/source.h"
+#include "../../include/ast_cache.h"
+#include "../../include/pool.h"
+#include "../../include/fold.h"
+
+// Bytes read at a time when lexing piped input as it arrives
+#define STREAM_CHUNK (64 * 1024)
+
+static const char usage[] =
+    "Usage: phase2-w25 [--lex | --syntax | --check | --dump-ast=json | --dump-ast=binary]\n"
+    "                  [--verbose] [--ast-cache DIR] [--jobs N] [--files-from LIST] FILE...\n";
+
+// What a run does with its input
+typedef enum {
+    RUN_LEX,            // Report lexical errors
+    RUN_SYNTAX,         // Lex and parse; report syntax errors
+    RUN_CHECK,          // Parse and analyze; report syntax and semantic errors
+    RUN_DUMP_JSON,      // Write the tree as JSON
+    RUN_DUMP_BINARY     // Write the tree as an AST image (the --ast-cache format)
+} RunMode;
+
+typedef struct {
+    RunMode mode;
+    int verbose;                // Also list the input and what each phase built
+    int jobs;                   // Files run at once in a batch
+    int lex_threads;            // Threads each file is lexed on
+    const char* cache_dir;
+    const char* manifest;       // File listing more inputs, one per line
+    const char* path;           // The file being run
+} Options;
+
+// The input files, from the command line and the manifest
+typedef struct {
+    const char** paths;
+    uint32_t count;
+    uint32_t capacity;
+    char* manifest;             // Manifest text, cut into the paths in it
+} FileList;
+
+static int add_file(FileList* files, const char* path) {
+    if (files->count == files->capacity) {
+        uint32_t capacity = files->capacity ? files->capacity * 2 : 16;
+        const char** paths = realloc(files->paths, capacity * sizeof(*paths));
+        if (!paths) return 0;
+        files->paths = paths;
+        files->capacity = capacity;
+    }
+    files->paths[files->count++] = path;
+    return 1;
+}
+
+static void free_file_list(FileList* files) {
+    free(files->paths);
+    free(files->manifest);
+}
+
+static int cores(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+static int parse_options(int argc, char* argv[], Options* options, FileList* files) {
+    options->mode = RUN_CHECK;
+    options->verbose = 0;
+    options->jobs = cores();
+    options->lex_threads = cores();
+    options->cache_dir = NULL;
+    options->manifest = NULL;
+    options->path = NULL;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--lex") == 0) {
+            options->mode = RUN_LEX;
+        } else if (strcmp(arg, "--syntax") == 0) {
+            options->mode = RUN_SYNTAX;
+        } else if (strcmp(arg, "--check") == 0) {
+            options->mode = RUN_CHECK;
+        } else if (strcmp(arg, "--dump-ast=json") == 0) {
+            options->mode = RUN_DUMP_JSON;
+        } else if (strcmp(arg, "--dump-ast=binary") == 0) {
+            options->mode = RUN_DUMP_BINARY;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            options->verbose = 1;
+        } else if (strcmp(arg, "--ast-cache") == 0 && i + 1 < argc) {
+            options->cache_dir = argv[++i];
+        } else if (strcmp(arg, "--jobs") == 0 && i + 1 < argc) {
+            options->jobs = atoi(argv[++i]);
+            if (options->jobs < 1) return 0;
+        } else if (strcmp(arg, "--files-from") == 0 && i + 1 < argc) {
+            options->manifest = argv[++i];
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            return 0;
+        } else if (!add_file(files, arg)) {
+            return 0;
+        }
+    }
+    return files->count > 0 || options->manifest != NULL;
+}
+
+// Add the paths listed in the manifest, one per line; blank lines are
+// skipped. Returns 0 with errno set if it could not be read.
+static int read_manifest(FileList* files, const char* path) {
+    SourceFile source;
+    if (source_open(&source, path) != 0) return 0;
+    files->manifest = malloc(source.size + 1);
+    if (!files->manifest) {
+        source_close(&source);
+        errno = ENOMEM;
+        return 0;
+    }
+    memcpy(files->manifest, source.data, source.size + 1);
+    source_close(&source);
+
+    char* line = files->manifest;
+    while (*line) {
+        char* end = strchr(line, '\n');
+        char* next = end ? end + 1 : line + strlen(line);
+        if (!end) end = next;
+        if (end > line && end[-1] == '\r') end--;
+        *end = '\0';
+        if (*line && !add_file(files, line)) {
+            errno = ENOMEM;
+            return 0;
+        }
+        line = next;
+    }
+    return 1;
+}
+
+static const char* plural(int count) {
+    return count == 1 ? "" : "s";
+}
+
+// Lex the input on every core and report the tokens' errors; returns the
+// number of errors, or -1 if memory ran out
+static int run_lex(Sink* out, const Options* options, const char* input) {
+    InternTable atoms;
+    Lexer lexer;
+    TokenBuffer tokens;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error while lexing %s\n", options->path);
+        return -1;
+    }
+    token_buffer_init(&tokens);
+    lexer_init(&lexer, input, &atoms);
+    lexer.out = out;
+
+    int errors = -1;
+    if (lex_all_parallel(&lexer, &tokens, options->lex_threads)) {
+        errors = 0;
+        for (uint32_t i = 0; i < tokens.count; i++) {
+            if (options->verbose) {
+                print_token(out, input, token_buffer_get(&tokens, i));
+            } else if (tokens.errors[i] != ERROR_NONE) {
+                Token token = token_buffer_get(&tokens, i);
+                print_error(out, token.error, token.line, token_text(input, token));
+            }
+            errors += tokens.errors[i] != ERROR_NONE;
+        }
+        sink_printf(out, "%s: %u tokens, %d lexical error%s\n", options->path, tokens.count, errors, plural(errors));
+    } else {
+        fprintf(stderr, "Memory allocation error while lexing %s\n", options->path);
+    }
+    token_buffer_free(&tokens);
+    intern_free(&atoms);
+    return errors;
+}
+
+// Same as run_lex for input that cannot be mapped, like a pipe: lex it as
+// it is read, holding only a window of it and its atoms, so it is never
+// buffered whole and is not bounded by the 32-bit offsets and lines of
+// in-memory lexing
+static int run_lex_stream(Sink* out, const Options* options, int fd) {
+    InternTable atoms;
+    StreamLexer stream;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error while lexing %s\n", options->path);
+        return -1;
+    }
+    if (!stream_lexer_init(&stream, fd, STREAM_CHUNK, &atoms)) {
+        fprintf(stderr, "Memory allocation error while lexing %s\n", options->path);
+        intern_free(&atoms);
+        return -1;
+    }
+    stream.lexer.out = out;
+
+    uint64_t errors = 0;
+    uint64_t count = 0;
+    uint64_t line;
+    Token token;
+    do {
+        token = stream_lexer_next(&stream, NULL, &line);
+        const char* window = stream.lexer.source;
+        if (options->verbose) {
+            print_token_at(out, window, token, line);
+        } else if (token.error != ERROR_NONE) {
+            print_error(out, token.error, line, token_text(window, token));
+        }
+        errors += token.error != ERROR_NONE;
+        count++;
+    } while (token.type != TOKEN_EOF);
+
+    int result = errors > INT_MAX ? INT_MAX : (int)errors;
+    if (stream.failed) {
+        fprintf(stderr, "Could not read %s to the end\n", options->path);
+        result = -1;
+    } else {
+        sink_printf(out, "%s: %llu tokens, %llu lexical error%s\n", options->path, (unsigned long long)count,
+                    (unsigned long long)errors, plural(errors == 1 ? 1 : 2));
+    }
+    stream_lexer_free(&stream);
+    intern_free(&atoms);
+    return result;
+}
+
+// Whether `path` is stdin coming from something other than a file
+static int is_piped(const char* path) {
+    struct stat st;
+    return strcmp(path, "-") == 0 && (fstat(STDIN_FILENO, &st) != 0 || !S_ISREG(st.st_mode));
+}
+
+// Lex the whole input up front (large inputs on `threads` threads), then
+// parse from the token buffer; NULL if memory ran out
+static const Ast* parse_input(Parser** parser, TokenBuffer* tokens, Sink* out, int quiet, int threads,
+                              const char* input, InternTable* atoms) {
+    Lexer lexer;
+    lexer_init(&lexer, input, atoms);
+    lexer.out = out;
+    lexer.quiet = quiet;
+    if (!lex_all_parallel(&lexer, tokens, threads)) return NULL;
+    *parser = parser_create();
+    if (!*parser || parser_parse_tokens(*parser, input, tokens) == AST_NO_NODE) return NULL;
+    return parser_ast(*parser);
+}
+
+// One JSON object: the file, its parse diagnostics (one string per line)
+// and the tree
+static int dump_json(Sink* out, const char* path, const char* input, const Ast* ast,
+                     const char* diagnostics, int syntax_errors) {
+    sink_puts(out, "{\"file\":");
+    json_write_string(out, path, strlen(path));
+    sink_printf(out, ",\"syntax_errors\":%d,\"diagnostics\":[", syntax_errors);
+    const char* line = diagnostics;
+    while (*line) {
+        const char* end = strchr(line, '\n');
+        size_t length = end ? (size_t)(end - line) : strlen(line);
+        if (line != diagnostics) sink_puts(out, ",");
+        json_write_string(out, line, length);
+        line += length + (end != NULL);
+    }
+    sink_puts(out, "],\"ast\":");
+    int written = print_ast_json(out, input, ast, ast->root);
+    sink_puts(out, "}\n");
+    return written;
+}
+
+// Fold the constants of a program that has no errors; with --verbose,
+// print the folded tree. Returns 0 if memory ran out.
+static int run_fold(Sink* out, const Options* options, const char* input, const Ast* ast,
+                    const Resolution* resolution, InternTable* atoms) {
+    FoldedProgram folded;
+    if (!fold_constants(ast, input, resolution, atoms, &folded)) {
+        fprintf(stderr, "Memory allocation error while folding %s\n", options->path);
+        return 0;
+    }
+    if (options->verbose && folded.ast == ast) {
+        sink_puts(out, "\nConstant Folding Found Nothing To Fold\n");
+    } else if (options->verbose) {
+        sink_printf(out, "\nFolded Abstract Syntax Tree (%u expression%s folded, %u statement%s removed):\n",
+                    folded.folded, plural((int)folded.folded), folded.removed, plural((int)folded.removed));
+        print_ast(out, folded.source, folded.ast, folded.ast->root, 0);
+    }
+    folded_program_free(&folded);
+    return 1;
+}
+
+// Every mode but --lex: get the tree from the cache or by parsing, then
+// report or dump it. Returns the number of errors, or -1 if the run failed.
+static int run_parse(Sink* out, const Options* options, const SourceFile* source) {
+    const char* input = source->data;
+    int dump = options->mode == RUN_DUMP_JSON || options->mode == RUN_DUMP_BINARY;
+    int verbose = options->verbose && !dump;
+    if (verbose) {
+        sink_puts(out, "Parsing input:\n");
+        sink_puts(out, input);
+        sink_puts(out, "\n");
+    }
+
+    InternTable atoms;
+    if (!intern_init(&atoms)) {
+        fprintf(stderr, "Memory allocation error while parsing %s\n", options->path);
+        return -1;
+    }
+    uint64_t hash = options->cache_dir || options->mode == RUN_DUMP_BINARY ? source_hash(source) : 0;
+    AstImage image = {0};
+    Parser* parser = NULL;
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    const Ast* ast;
+    const char* diagnostics = "";
+    int syntax_errors = 0;
+    if (options->cache_dir && ast_cache_load(&image, options->cache_dir, hash, source->size, &atoms)) {
+        ast = &image.ast;
+        diagnostics = image.diagnostics;
+        syntax_errors = image.error_count;
+    } else {
+        // Dumps leave stdout to the tree, so lexer warnings are dropped
+        ast = parse_input(&parser, &tokens, out, dump, options->lex_threads, input, &atoms);
+        if (ast) {
+            diagnostics = parser_diagnostics(parser);
+            syntax_errors = parser_error_count(parser);
+            // A cache that cannot be written only costs the next run a parse
+            if (options->cache_dir) {
+                ast_cache_store(options->cache_dir, hash, source->size, ast, &atoms, diagnostics, syntax_errors);
+            }
+        } else {
+            fprintf(stderr, "Memory allocation error while parsing %s\n", options->path);
+        }
+    }
+
+    int errors = -1;
+    if (ast && options->mode == RUN_DUMP_BINARY) {
+        if (ast_image_write(out, hash, source->size, ast, &atoms, diagnostics, syntax_errors)) errors = syntax_errors;
+    } else if (ast && options->mode == RUN_DUMP_JSON) {
+        if (dump_json(out, options->path, input, ast, diagnostics, syntax_errors)) errors = syntax_errors;
+    } else if (ast) {
+        sink_puts(out, diagnostics);
+        if (verbose) {
+            sink_puts(out, "\nAbstract Syntax Tree:\n");
+            print_ast(out, input, ast, ast->root, 0);
+        }
+        if (options->mode == RUN_SYNTAX) {
+            errors = syntax_errors;
+            sink_printf(out, "%s: %d syntax error%s\n", options->path, syntax_errors, plural(syntax_errors));
+        } else {
+            SymbolTable* table = init_symbol_table(&atoms, out);
+            Resolution resolution = {0};
+            if (table) {
+                int semantic_errors = analyze_semantics(ast, table, &resolution);
+                if (verbose) {
+                    if (semantic_errors == 0) {
+                        sink_puts(out, "\nSemantic Analysis Completed Successfully\n");
+                    } else {
+                        sink_puts(out, "\nSemantic Analysis Failed With Errors\n");
+                    }
+                    print_table(out, table);
+                }
+                errors = syntax_errors + semantic_errors;
+                if (errors == 0 && !run_fold(out, options, input, ast, &resolution, &atoms)) errors = -1;
+                sink_printf(out, "%s: %d syntax error%s, %d semantic error%s\n", options->path,
+                            syntax_errors, plural(syntax_errors), semantic_errors, plural(semantic_errors));
+                resolution_free(&resolution);
+                free_symbol_table(table);
+            } else {
+                fprintf(stderr, "Memory allocation error for the symbol table\n");
+            }
+        }
+    }
+
+    ast_image_close(&image);
+    parser_destroy(parser);
+    token_buffer_free(&tokens);
+    intern_free(&atoms);
+    return errors;
+}
+
+// Run one file; returns the number of errors found, or -1 if the run
+// failed
+static int run_file(Sink* out, const Options* options) {
+    if (options->mode == RUN_LEX && is_piped(options->path)) {
+        return run_lex_stream(out, options, STDIN_FILENO);
+    }
+    SourceFile source;
+    if (source_open(&source, options->path) != 0) {
+        if (errno == EFBIG) {
+            fprintf(stderr, "Could not read %s: inputs of 4 GiB or more are not supported\n", options->path);
+        } else {
+            fprintf(stderr, "Could not read %s: %s\n", options->path, strerror(errno));
+        }
+        return -1;
+    }
+    int errors = options->mode == RUN_LEX
+        ? run_lex(out, options, source.data)
+        : run_parse(out, options, &source);
+    source_close(&source);
+    return errors;
+}
+
+// A batch runs each file into its own memory sink on the pool. Outputs are
+// printed in the order the files were given: whichever worker finishes the
+// next file to print also prints every finished file after it.
+typedef struct {
+    const Options* options;
+    const FileList* files;
+    Sink* out;
+    Sink* outputs;              // Each file's output, until it is printed
+    int* results;               // Errors in each file, or -1 if its run failed
+    uint8_t* finished;
+    uint32_t printed;           // Files printed so far
+    pthread_mutex_t lock;       // Guards `finished`, `printed` and `out`
+} Batch;
+
+static void run_batch_file(uint32_t index, void* context) {
+    Batch* batch = context;
+    Options options = *batch->options;
+    options.path = batch->files->paths[index];
+    Sink* output = &batch->outputs[index];
+    if (!sink_init_memory(output)) {
+        fprintf(stderr, "Memory allocation error for the output of %s\n", options.path);
+        batch->results[index] = -1;
+    } else {
+        batch->results[index] = run_file(output, &options);
+        if (!sink_flush(output)) {
+            fprintf(stderr, "Memory allocation error for the output of %s\n", options.path);
+            batch->results[index] = -1;
+        }
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    batch->finished[index] = 1;
+    while (batch->printed < batch->files->count && batch->finished[batch->printed]) {
+        Sink* next = &batch->outputs[batch->printed++];
+        if (next->buffer) sink_write(batch->out, next->buffer, next->length);
+        sink_close(next);
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
+
+// Run every file on `options->jobs` threads, then print how many had
+// errors; returns the number of files with errors, or -1 if any run
+// failed
+static int run_batch(Sink* out, const Options* options, const FileList* files) {
+    Batch batch = {0};
+    batch.options = options;
+    batch.files = files;
+    batch.out = out;
+    batch.outputs = calloc(files->count, sizeof(Sink));
+    batch.results = calloc(files->count, sizeof(int));
+    batch.finished = calloc(files->count, 1);
+    if (!batch.outputs || !batch.results || !batch.finished) {
+        fprintf(stderr, "Memory allocation error for the batch\n");
+        free(batch.outputs);
+        free(batch.results);
+        free(batch.finished);
+        return -1;
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+    pool_run(options->jobs, files->count, run_batch_file, &batch);
+    pthread_mutex_destroy(&batch.lock);
+
+    int with_errors = 0, failed = 0;
+    for (uint32_t i = 0; i < files->count; i++) {
+        with_errors += batch.results[i] > 0;
+        failed += batch.results[i] < 0;
+    }
+    // Dumps leave stdout to the trees
+    if (options->mode != RUN_DUMP_JSON) {
+        sink_printf(out, "%u file%s: %d with errors, %d failed\n", files->count, plural((int)files->count),
+                    with_errors, failed);
+    }
+    free(batch.outputs);
+    free(batch.results);
+    free(batch.finished);
+    return failed ? -1 : with_errors;
+}
+
+// Usage: phase2-w25 [MODE] [--verbose] [--ast-cache DIR] [--jobs N]
+//                   [--files-from LIST] FILE...
+// A run checks FILE and prints only its errors and a one-line summary:
+//   --lex               lexical errors
+//   --syntax            lexical and syntax errors
+//   --check             syntax and semantic errors (the default)
+//   --dump-ast=json     the tree, with its parse diagnostics, as JSON
+//   --dump-ast=binary   the tree as an AST image, the --ast-cache format
+// --verbose also lists the input, the tokens or the tree, and the symbol
+// table, and for a program without errors the tree after constant
+// folding. With --ast-cache, parse results are kept in DIR keyed by the
+// contents of FILE, and a file parsed before is neither lexed nor parsed
+// again. All output goes through one buffered sink on stdout. --lex reads
+// piped input as it arrives, in bounded memory; everything else is loaded
+// whole and must be smaller than 4 GiB.
+//
+// Given several files, or a LIST of them (one path per line, "-" for
+// stdin), the run is a batch: the files are run on N threads (one per core
+// by default), each file lexed, parsed and checked on one thread with
+// state of its own, and their outputs are printed in the order the files
+// were given, followed by a line counting the files with errors. A batch
+// cannot dump binary images.
+//
+// Exits with 0 if no errors were found, 1 if some were, and 2 if the run
+// itself failed (in a batch, if the run of any file did).
+int main(int argc, char* argv[]) {
+    Options options;
+    FileList files = {0};
+    if (!parse_options(argc, argv, &options, &files)) {
+        fputs(usage, stderr);
+        free_file_list(&files);
+        return 2;
+    }
+    if (options.manifest && !read_manifest(&files, options.manifest)) {
+        fprintf(stderr, "Could not read %s: %s\n", options.manifest, strerror(errno));
+        free_file_list(&files);
+        return 2;
+    }
+    int batch = options.manifest != NULL || files.count > 1;
+    if (batch && options.mode == RUN_DUMP_BINARY) {
+        fputs(usage, stderr);
+        free_file_list(&files);
+        return 2;
+    }
+
+    Sink out;
+    if (!sink_init(&out, STDOUT_FILENO)) {
+        fprintf(stderr, "Memory allocation error for the output buffer\n");
+        free_file_list(&files);
+        return 2;
+    }
+    int errors;
+    if (batch) {
+        // The files share the cores, so each is lexed on one
+        options.lex_threads = 1;
+        errors = run_batch(&out, &options, &files);
+    } else {
+        options.path = files.paths[0];
+        errors = run_file(&out, &options);
+    }
+    if (!sink_close(&out)) {
+        fprintf(stderr, "Could not write the output\n");
+        errors = -1;
+    }
+    free_file_list(&files);
+    return errors < 0 ? 2 : errors > 0;
+}
@@ -0,0 +1,139 @@
+/* source.c */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../include/source.h"
+
+#define READ_CHUNK (64 * 1024)
+
+// Fallback for pipes and other inputs that cannot be mapped
+static int read_all(SourceFile* source, int fd) {
+    size_t capacity = READ_CHUNK;
+    size_t size = 0;
+    char* buffer = malloc(capacity + 1);
+    if (!buffer) return -1;
+
+    for (;;) {
+        if (size == capacity) {
+            char* grown = realloc(buffer, capacity * 2 + 1);
+            if (!grown) {
+                free(buffer);
+                return -1;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, buffer + size, capacity - size);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buffer);
+            return -1;
+        }
+        size += (size_t)n;
+        if (size > SOURCE_MAX_SIZE) {
+            free(buffer);
+            errno = EFBIG;
+            return -1;
+        }
+    }
+
+    buffer[size] = '\0';
+    source->data = buffer;
+    source->size = size;
+    return 0;
+}
+
+// Map a regular file so that the byte after its contents reads as NUL.
+// The kernel zero-fills the rest of the last page, so only a file whose
+// size is an exact multiple of the page size needs an extra page: reserve
+// one anonymous (zeroed) page past the end and map the file in front of it.
+static int map_file(SourceFile* source, int fd, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t map_size = size % page ? size : size + page;
+    void* base = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return -1;
+
+    if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int saved = errno;
+        munmap(base, map_size);
+        errno = saved;
+        return -1;
+    }
+    madvise(base, map_size, MADV_SEQUENTIAL);
+
+    source->data = base;
+    source->size = size;
+    source->map = base;
+    source->map_size = map_size;
+    return 0;
+}
+
+int source_open(SourceFile* source, const char* path) {
+    source->data = NULL;
+    source->size = 0;
+    source->map = NULL;
+    source->map_size = 0;
+
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    int regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    int result;
+    if (regular && (uint64_t)st.st_size > SOURCE_MAX_SIZE) {
+        errno = EFBIG;
+        result = -1;
+    } else if (regular && st.st_size > 0) {
+        result = map_file(source, fd, (size_t)st.st_size);
+        if (result != 0) result = read_all(source, fd);
+    } else {
+        result = read_all(source, fd);
+    }
+
+    if (fd != STDIN_FILENO) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+    }
+    return result;
+}
+
+void source_close(SourceFile* source) {
+    if (source->map) {
+        munmap(source->map, source->map_size);
+    } else {
+        free((char*)source->data);
+    }
+    source->data = NULL;
+    source->map = NULL;
+}
+
+// Multiply-xorshift over 8 bytes at a time, finished with the MurmurHash3
+// mixer; the length is mixed in first so trailing NULs change the hash
+uint64_t source_hash(const SourceFile* source) {
+    const unsigned char* data = (const unsigned char*)source->data;
+    size_t size = source->size;
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < size; i++, shift += 8) {
+        tail |= (uint64_t)data[i] << shift;
+    }
+    h = (h ^ tail) * 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,186 @@
+/* intern.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/intern.h"
+
+#define INTERN_INITIAL_SLOTS 256
+#define INTERN_ARENA_BLOCK (64 * 1024)
+
+// Spellings of the predefined atoms, indexed by atom
+static const char* predefined[ATOM_PREDEFINED_COUNT] = {
+    [ATOM_NONE] = "",
+    [ATOM_IF] = "if",
+    [ATOM_INT] = "int",
+    [ATOM_BOOL] = "bool",
+    [ATOM_FLOAT] = "float",
+    [ATOM_CHAR] = "char",
+    [ATOM_STRING] = "string",
+    [ATOM_PRINT] = "print",
+    [ATOM_WHILE] = "while",
+    [ATOM_REPEAT] = "repeat",
+    [ATOM_UNTIL] = "until",
+    [ATOM_DO] = "do",
+    [ATOM_FACTORIAL] = "factorial",
+    [ATOM_PLUS] = "+",
+    [ATOM_MINUS] = "-",
+    [ATOM_STAR] = "*",
+    [ATOM_SLASH] = "/",
+    [ATOM_LT] = "<",
+    [ATOM_GT] = ">",
+    [ATOM_EQ] = "==",
+    [ATOM_NE] = "!=",
+};
+
+// FNV-1a
+static uint32_t hash_bytes(const char* text, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)text[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Find the slot holding `text`, or the empty slot where it would go
+static uint32_t find_slot(const InternTable* table, const char* text, size_t length, uint32_t h) {
+    uint32_t i = h & table->slot_mask;
+    for (;;) {
+        Atom atom = table->slots[i];
+        if (atom == ATOM_NONE) return i;
+        if (table->hash[atom] == h && table->length[atom] == length &&
+            memcmp(table->text[atom], text, length) == 0) {
+            return i;
+        }
+        i = (i + 1) & table->slot_mask;
+    }
+}
+
+// Put `atom` in the first free slot from its hash on
+static void place(InternTable* table, Atom atom) {
+    uint32_t i = table->hash[atom] & table->slot_mask;
+    while (table->slots[i] != ATOM_NONE) i = (i + 1) & table->slot_mask;
+    table->slots[i] = atom;
+}
+
+static int grow_slots(InternTable* table) {
+    uint32_t slot_count = (table->slot_mask + 1) * 2;
+    Atom* slots = calloc(slot_count, sizeof(Atom));
+    if (!slots) return 0;
+    free(table->slots);
+    table->slots = slots;
+    table->slot_mask = slot_count - 1;
+    for (Atom atom = 1; atom < table->count; atom++) place(table, atom);
+    return 1;
+}
+
+static int grow_entries(InternTable* table) {
+    uint32_t capacity = table->capacity * 2;
+    const char** text = realloc(table->text, capacity * sizeof(*text));
+    if (!text) return 0;
+    table->text = text;
+    uint32_t* length = realloc(table->length, capacity * sizeof(*length));
+    if (!length) return 0;
+    table->length = length;
+    uint32_t* hash = realloc(table->hash, capacity * sizeof(*hash));
+    if (!hash) return 0;
+    table->hash = hash;
+    NumberValue* numbers = realloc(table->numbers, capacity * sizeof(*numbers));
+    if (!numbers) return 0;
+    table->numbers = numbers;
+    table->capacity = capacity;
+    return 1;
+}
+
+int intern_init(InternTable* table) {
+    arena_init(&table->bytes, INTERN_ARENA_BLOCK);
+    table->capacity = INTERN_INITIAL_SLOTS / 2;
+    table->text = malloc(table->capacity * sizeof(*table->text));
+    table->length = malloc(table->capacity * sizeof(*table->length));
+    table->hash = malloc(table->capacity * sizeof(*table->hash));
+    table->numbers = malloc(table->capacity * sizeof(*table->numbers));
+    table->slots = calloc(INTERN_INITIAL_SLOTS, sizeof(Atom));
+    table->slot_mask = INTERN_INITIAL_SLOTS - 1;
+    table->count = 0;
+    if (!table->text || !table->length || !table->hash || !table->numbers || !table->slots) {
+        intern_free(table);
+        return 0;
+    }
+
+    // The predefined spellings are not copied into the arena, so they
+    // outlive intern_reset. ATOM_NONE occupies entry 0 but is never placed
+    // in a slot.
+    for (Atom atom = 0; atom < ATOM_PREDEFINED_COUNT; atom++) {
+        table->text[atom] = predefined[atom];
+        table->length[atom] = (uint32_t)strlen(predefined[atom]);
+        table->hash[atom] = hash_bytes(predefined[atom], table->length[atom]);
+        table->numbers[atom].kind = NUMBER_NONE;
+        if (atom != ATOM_NONE) place(table, atom);
+    }
+    table->count = ATOM_PREDEFINED_COUNT;
+    return 1;
+}
+
+void intern_reset(InternTable* table) {
+    arena_reset(&table->bytes);
+    memset(table->slots, 0, (table->slot_mask + 1) * sizeof(Atom));
+    table->count = ATOM_PREDEFINED_COUNT;
+    for (Atom atom = 1; atom < ATOM_PREDEFINED_COUNT; atom++) place(table, atom);
+}
+
+Atom intern(InternTable* table, const char* text, size_t length) {
+    uint32_t h = hash_bytes(text, length);
+    uint32_t i = find_slot(table, text, length, h);
+    if (table->slots[i] != ATOM_NONE) return table->slots[i];
+
+    // Keep the load factor at or below one half
+    if ((table->count + 1) * 2 > table->slot_mask + 1) {
+        if (!grow_slots(table)) return ATOM_NONE;
+        i = find_slot(table, text, length, h);
+    }
+    if (table->count == table->capacity && !grow_entries(table)) return ATOM_NONE;
+
+    char* copy = arena_alloc_bytes(&table->bytes, length + 1);
+    if (!copy) return ATOM_NONE;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+
+    Atom atom = table->count++;
+    table->text[atom] = copy;
+    table->length[atom] = (uint32_t)length;
+    table->hash[atom] = h;
+    table->numbers[atom].kind = NUMBER_NONE;
+    table->slots[i] = atom;
+    return atom;
+}
+
+Atom intern_find(const InternTable* table, const char* text, size_t length) {
+    return table->slots[find_slot(table, text, length, hash_bytes(text, length))];
+}
+
+const char* atom_text(const InternTable* table, Atom atom) {
+    return table->text[atom];
+}
+
+uint32_t atom_length(const InternTable* table, Atom atom) {
+    return table->length[atom];
+}
+
+const NumberValue* atom_number(const InternTable* table, Atom atom) {
+    return &table->numbers[atom];
+}
+
+void intern_free(InternTable* table) {
+    arena_free(&table->bytes);
+    free(table->text);
+    free(table->length);
+    free(table->hash);
+    free(table->numbers);
+    free(table->slots);
+    table->text = NULL;
+    table->length = NULL;
+    table->hash = NULL;
+    table->numbers = NULL;
+    table->slots = NULL;
+    table->count = 0;
+}
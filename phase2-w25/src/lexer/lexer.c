@@ -1,200 +1,270 @@
 /* lexer.c */
+#include <errno.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <ctype.h>
 #include <string.h>
 
 #include "../../include/tokens.h"
 #include "../../include/lexer.h"
 
-static int current_line = 1;
-static char last_token_type = 'x';
-
-// Keywords table
-static struct {
-    const char* word;
-    TokenType type;
-} keywords[] = {
-    {"if", TOKEN_IF},
-    {"int", TOKEN_INT},
-    {"bool", TOKEN_BOOL},
-    {"float", TOKEN_FLOAT},
-    {"char", TOKEN_CHAR},
-    {"string", TOKEN_STRING},
-    {"print", TOKEN_PRINT},
-    {"while", TOKEN_WHILE},
-    {"repeat", TOKEN_REPEAT},
-    {"until", TOKEN_UNTIL},
-    {"do", TOKEN_DO},
-    {"factorial", TOKEN_FACTORIAL}
+// Keywords table, indexed by the keyword's predefined atom
+static const TokenType keyword_types[ATOM_LAST_KEYWORD + 1] = {
+    [ATOM_IF] = TOKEN_IF,
+    [ATOM_INT] = TOKEN_INT,
+    [ATOM_BOOL] = TOKEN_BOOL,
+    [ATOM_FLOAT] = TOKEN_FLOAT,
+    [ATOM_CHAR] = TOKEN_CHAR,
+    [ATOM_STRING] = TOKEN_STRING,
+    [ATOM_PRINT] = TOKEN_PRINT,
+    [ATOM_WHILE] = TOKEN_WHILE,
+    [ATOM_REPEAT] = TOKEN_REPEAT,
+    [ATOM_UNTIL] = TOKEN_UNTIL,
+    [ATOM_DO] = TOKEN_DO,
+    [ATOM_FACTORIAL] = TOKEN_FACTORIAL
 };
 
-static int is_keyword(const char* word) {
-    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
-        if (strcmp(word, keywords[i].word) == 0) {
-            return keywords[i].type;
-        }
+static int is_keyword(Atom atom) {
+    return atom != ATOM_NONE && atom <= ATOM_LAST_KEYWORD ? keyword_types[atom] : 0;
+}
+
+TokenText token_text(const char* source, Token token) {
+    TokenText text;
+    if (token.type == TOKEN_EOF) {
+        text.text = "EOF";
+        text.length = 3;
+    } else {
+        text.text = source + token.offset;
+        text.length = token.length;
     }
-    return 0;
+    return text;
 }
 
-void print_error(ErrorType error, int line, const char* lexeme) {
-    printf("Lexical Error at line %d: ", line);
+void print_error(Sink* out, ErrorType error, uint64_t line, TokenText lexeme) {
+    sink_printf(out, "Lexical Error at line %llu: ", (unsigned long long)line);
     switch(error) {
         case ERROR_INVALID_CHAR:
-            printf("Invalid character '%s'\n", lexeme);
+            sink_printf(out, "Invalid character '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case ERROR_INVALID_NUMBER:
-            printf("Invalid number format\n");
+            sink_puts(out, "Invalid number format\n");
             break;
         case ERROR_CONSECUTIVE_OPERATORS:
-            printf("Consecutive operators not allowed\n");
+            sink_puts(out, "Consecutive operators not allowed\n");
             break;
         case ERROR_INVALID_IDENTIFIER:
-            printf("Invalid identifier\n");
+            sink_puts(out, "Invalid identifier\n");
             break;
         case ERROR_UNEXPECTED_TOKEN:
-            printf("Unexpected token '%s'\n", lexeme);
+            sink_printf(out, "Unexpected token '%.*s'\n", lexeme.length, lexeme.text);
             break;
         default:
-            printf("Unknown error\n");
+            sink_puts(out, "Unknown error\n");
     }
 }
 
-void print_token(Token token) {
+void print_char_length_warning(Sink* out, char c) {
+    sink_printf(out, "WARNING: Invalid char length! truncating to single digit length.'%c'\n", c);
+}
+
+int lexer_warned_char_length(const char* source, size_t start, Token token) {
+    if (source[start] != '\'' || token.length != 1) return 0;
+    char next = source[token.offset + 1];
+    return next != '\'' && next != '\0';
+}
+
+void print_token(Sink* out, const char* source, Token token) {
+    print_token_at(out, source, token, (uint64_t)token.line);
+}
+
+void print_token_at(Sink* out, const char* source, Token token, uint64_t line) {
+    TokenText lexeme = token_text(source, token);
     if (token.error != ERROR_NONE) {
-        print_error(token.error, token.line, token.lexeme);
+        print_error(out, token.error, line, lexeme);
         return;
     }
 
-    printf("Token: ");
+    sink_puts(out, "Token: ");
     switch(token.type) {
-        case TOKEN_NUMBER:     printf("NUMBER"); break;
-        case TOKEN_OPERATOR:   printf("OPERATOR"); break;
-        case TOKEN_IDENTIFIER: printf("IDENTIFIER"); break;
-        case TOKEN_EQUALS:     printf("EQUALS"); break;
-        case TOKEN_SEMICOLON:  printf("SEMICOLON"); break;
-        case TOKEN_LPAREN:     printf("LPAREN"); break;
-        case TOKEN_RPAREN:     printf("RPAREN"); break;
-        case TOKEN_LBRACE:     printf("LBRACE"); break;
-        case TOKEN_RBRACE:     printf("RBRACE"); break;
-        case TOKEN_IF:         printf("IF"); break;
-        case TOKEN_INT:        printf("INT"); break;
-        case TOKEN_STRING:        printf("STRING"); break;
-        case TOKEN_FLOAT:        printf("FLOAT"); break;
-        case TOKEN_CHAR:        printf("CHAR"); break;
-        case TOKEN_BOOL:        printf("BOOL"); break;
-        case TOKEN_PRINT:      printf("PRINT"); break;
-        case TOKEN_COMPARISON: printf("COMPARISON"); break;
-        case TOKEN_DO:      printf("DO"); break;
-        case TOKEN_WHILE:      printf("WHILE"); break;
-        case TOKEN_REPEAT:      printf("REPEAT"); break;
-        case TOKEN_UNTIL:      printf("UNTIL"); break;
-        case TOKEN_EOF:        printf("EOF"); break;
-        case TOKEN_FACTORIAL:  printf("FACTORIAL"); break;
-        default:              printf("UNKNOWN");
+        case TOKEN_NUMBER:     sink_puts(out, "NUMBER"); break;
+        case TOKEN_OPERATOR:   sink_puts(out, "OPERATOR"); break;
+        case TOKEN_IDENTIFIER: sink_puts(out, "IDENTIFIER"); break;
+        case TOKEN_EQUALS:     sink_puts(out, "EQUALS"); break;
+        case TOKEN_SEMICOLON:  sink_puts(out, "SEMICOLON"); break;
+        case TOKEN_LPAREN:     sink_puts(out, "LPAREN"); break;
+        case TOKEN_RPAREN:     sink_puts(out, "RPAREN"); break;
+        case TOKEN_LBRACE:     sink_puts(out, "LBRACE"); break;
+        case TOKEN_RBRACE:     sink_puts(out, "RBRACE"); break;
+        case TOKEN_IF:         sink_puts(out, "IF"); break;
+        case TOKEN_INT:        sink_puts(out, "INT"); break;
+        case TOKEN_STRING:        sink_puts(out, "STRING"); break;
+        case TOKEN_FLOAT:        sink_puts(out, "FLOAT"); break;
+        case TOKEN_CHAR:        sink_puts(out, "CHAR"); break;
+        case TOKEN_BOOL:        sink_puts(out, "BOOL"); break;
+        case TOKEN_PRINT:      sink_puts(out, "PRINT"); break;
+        case TOKEN_COMPARISON: sink_puts(out, "COMPARISON"); break;
+        case TOKEN_DO:      sink_puts(out, "DO"); break;
+        case TOKEN_WHILE:      sink_puts(out, "WHILE"); break;
+        case TOKEN_REPEAT:      sink_puts(out, "REPEAT"); break;
+        case TOKEN_UNTIL:      sink_puts(out, "UNTIL"); break;
+        case TOKEN_EOF:        sink_puts(out, "EOF"); break;
+        case TOKEN_FACTORIAL:  sink_puts(out, "FACTORIAL"); break;
+        default:              sink_puts(out, "UNKNOWN");
+    }
+    sink_printf(out, " | Lexeme: '%.*s' | Line: %llu\n", lexeme.length, lexeme.text, (unsigned long long)line);
+}
+
+void lexer_init(Lexer* lexer, const char* input, InternTable* atoms) {
+    lexer->source = input;
+    lexer->pos = 0;
+    lexer->line = 1;
+    lexer->line_start = 0;
+    lexer->last_type = TOKEN_EOF;
+    lexer->scan = scan_ops_best();
+    lexer->atoms = atoms;
+    lexer->engine = LEXER_HANDWRITTEN;
+    lexer->quiet = 0;
+    lexer->out = NULL;
+}
+
+// Column (1-based) of the next unread character
+int lexer_column(const Lexer* lexer) {
+    return (int)(lexer->pos - lexer->line_start + 1);
+}
+
+// Decode a number literal from its text; returns 0 if it is out of range
+static int decode_number(const char* text, NumberValue* number) {
+    int64_t value = 0;
+    const char* p;
+    for (p = text; scan_is_digit(*p); p++) {
+        int digit = *p - '0';
+        if (value > (INT64_MAX - digit) / 10) break;
+        value = value * 10 + digit;
+    }
+    if (*p == '\0') {
+        number->kind = NUMBER_INT;
+        number->i = value;
+        return 1;
+    }
+    while (scan_is_digit(*p)) p++;
+    if (*p != '.') return 0; // Integer overflow
+
+    errno = 0;
+    number->kind = NUMBER_FLOAT;
+    number->f = strtod(text, NULL);
+    return !(errno == ERANGE && number->f == HUGE_VAL);
+}
+
+void lexer_number(Lexer* lexer, Token* token) {
+    InternTable* atoms = lexer->atoms;
+    token->atom = intern(atoms, lexer->source + token->offset, token->length);
+    token->type = TOKEN_NUMBER;
+    if (token->atom == ATOM_NONE) return;
+
+    // Literals are decoded once, the first time their text is seen
+    NumberValue* number = &atoms->numbers[token->atom];
+    if (number->kind == NUMBER_NONE && !decode_number(atom_text(atoms, token->atom), number)) {
+        number->kind = NUMBER_INVALID;
+    }
+    if (number->kind == NUMBER_INVALID) {
+        token->type = TOKEN_ERROR;
+        token->error = ERROR_INVALID_NUMBER;
     }
-    printf(" | Lexeme: '%s' | Line: %d\n", token.lexeme, token.line);
 }
 
-Token get_next_token(const char* input, int* pos) {
-    Token token = {TOKEN_ERROR, "", current_line, ERROR_NONE};
+static Token scan_token(Lexer* lexer) {
+    const char* input = lexer->source;
+    size_t* pos = &lexer->pos;
+    Token token = {TOKEN_ERROR, ERROR_NONE, 0, 0, 0, ATOM_NONE};
+    size_t end;
     char c;
 
     // Skip whitespace and track line numbers
-    while ((c = input[*pos]) != '\0' && (c == ' ' || c == '\n' || c == '\t')) {
-        if (c == '\n') {
-            current_line++;
-        }
-        (*pos)++;
-    }
+    *pos = lexer->scan->skip_space(input, *pos, &lexer->line, &lexer->line_start);
+    token.line = lexer->line;
+    token.offset = *pos;
 
     if (input[*pos] == '\0') {
         token.type = TOKEN_EOF;
-        strcpy(token.lexeme, "EOF");
         return token;
     }
 
     c = input[*pos];
 
     if (c == '"') {
-        int i = 0;
         (*pos)++; // consume the opening double quote
-        c = input[*pos];
+        // The lexeme is the text between the quotes
+        token.offset = *pos;
         // Read characters until a closing double quote or end-of-file is found
-        while (c != '"' && c != '\0') {
-            // Optionally handle escape sequences here if needed
-            token.lexeme[i++] = c;
-            (*pos)++;
-            c = input[*pos];
-        }
-        if (c == '"') {
+        end = lexer->scan->skip_quoted(input, *pos, '"', &lexer->line, &lexer->line_start);
+        token.length = end - *pos;
+        token.atom = intern(lexer->atoms, input + *pos, token.length);
+        *pos = end;
+        if (input[*pos] == '"') {
             (*pos)++; // consume the closing double quote
-            token.lexeme[i] = '\0';
             token.type = TOKEN_STRING;
             return token;
         } else {
             // Unterminated string literal
             token.error = ERROR_INVALID_CHAR; // Or define a specific error like ERROR_INVALID_STRING
-            token.lexeme[i] = '\0';
             return token;
         }
     }
 
     // CHECK FOR CHARS
     if (c == '\'') {
-        int i = 0;
         (*pos)++;  // consume the opening single quote
+        token.offset = *pos;
         c = input[*pos];
         
         // Read the first character only
         if (c != '\'' && c != '\0') {
-            token.lexeme[i++] = c;
+            token.length = 1;
             (*pos)++;
-            c = input[*pos];
-            int j = 0;
+            if (c == '\n') {
+                lexer->line++;
+                lexer->line_start = *pos;
+            }
             // Skip any additional characters until closing quote
-            while (c != '\'' && c != '\0') {
-                if(!j)
-                {
-                    printf("WARNING: Invalid char length! truncating to single digit length.'%s'\n", token.lexeme);
-                }
-                (*pos)++;
-                c = input[*pos];
+            end = lexer->scan->skip_quoted(input, *pos, '\'', &lexer->line, &lexer->line_start);
+            if (end != *pos && !lexer->quiet) {
+                print_char_length_warning(lexer->out, input[token.offset]);
             }
+            *pos = end;
+            c = input[*pos];
         }
         
         if (c == '\'') {
             (*pos)++;  // consume the closing single quote
-            token.lexeme[i] = '\0';
+            token.atom = intern(lexer->atoms, input + token.offset, token.length);
             token.type = TOKEN_CHAR;
             return token;
         } else {
             // Unterminated char
             token.error = ERROR_INVALID_CHAR;
-            token.lexeme[i] = '\0';
             return token;
         }
     }
 
-    // Handle numbers
-    if (isdigit(c)) {
-        int i = 0;
-        short fflag = 0; // FLOAT FLAG
-        size_t max_lexeme_size = sizeof(token.lexeme) - 1;
-        do {
-            if(c == '.') 
-            {
-                fflag++; // If there is another '.' loop is broken
-                if(fflag > 1) break;
+    // Handle numbers: digits with at most one '.'
+    if (scan_is_digit(c)) {
+        int malformed = 0;
+        end = lexer->scan->skip_digits(input, *pos);
+        if (input[end] == '.') {
+            end = lexer->scan->skip_digits(input, end + 1);
+            // Any further '.' makes the whole run one bad literal (1.2.3)
+            while (input[end] == '.') {
+                malformed = 1;
+                end = lexer->scan->skip_digits(input, end + 1);
             }
-            token.lexeme[i++] = c;
-            (*pos)++;
-            c = input[*pos];
-        } while ((isdigit(c) || c == '.') && (size_t)i < max_lexeme_size);
-
-        token.lexeme[i] = '\0';
-        token.type = TOKEN_NUMBER;
+        }
+        token.length = end - *pos;
+        *pos = end;
+        if (malformed) {
+            token.error = ERROR_INVALID_NUMBER;
+        } else {
+            lexer_number(lexer, &token);
+        }
         return token;
     }
 
@@ -234,20 +304,14 @@ Token get_next_token(const char* input, int* pos) {
     // }
 
 
-    if (isalpha(c) || c == '_') {
-        int i = 0;
-        // Fix: use explicit size comparison with cast to avoid sign comparison warning
-        size_t max_lexeme_size = sizeof(token.lexeme) - 1;
-        do {
-            token.lexeme[i++] = c;
-            (*pos)++;
-            c = input[*pos];
-        } while ((isalnum(c) || c == '_') && (size_t)i < max_lexeme_size);
-
-        token.lexeme[i] = '\0';
+    if (scan_is_ident_start(c)) {
+        end = lexer->scan->skip_ident(input, *pos);
+        token.length = end - *pos;
+        token.atom = intern(lexer->atoms, input + *pos, token.length);
+        *pos = end;
 
         // Check if it's a keyword
-        TokenType keyword_type = is_keyword(token.lexeme);
+        TokenType keyword_type = is_keyword(token.atom);
         if (keyword_type) {
             token.type = keyword_type;
         } else {
@@ -258,24 +322,23 @@ Token get_next_token(const char* input, int* pos) {
 
     // Handle operators and delimiters
     (*pos)++;
-    token.lexeme[0] = c;
-    token.lexeme[1] = '\0';
+    token.length = 1;
 
     switch(c) {
         case '+': case '-': case '*': case '/':
-            if (last_token_type == 'o') {
+            if (lexer->last_type == TOKEN_OPERATOR) {
                 token.error = ERROR_CONSECUTIVE_OPERATORS;
                 return token;
             }
             token.type = TOKEN_OPERATOR;
-            last_token_type = 'o';
+            token.atom = c == '+' ? ATOM_PLUS : c == '-' ? ATOM_MINUS : c == '*' ? ATOM_STAR : ATOM_SLASH;
             break;
         case '=':
             if(input[*pos] == '='){
                 (*pos)++;
-                token.lexeme[1] = '=';
-                token.lexeme[2] = '\0';
+                token.length = 2;
                 token.type=TOKEN_COMPARISON;
+                token.atom = ATOM_EQ;
             }
             else{
                 token.type = TOKEN_EQUALS;
@@ -284,9 +347,9 @@ Token get_next_token(const char* input, int* pos) {
         case '!':
             if(input[*pos] == '='){
                 (*pos)++;
-                token.lexeme[1] = '=';
-                token.lexeme[2] = '\0';
+                token.length = 2;
                 token.type=TOKEN_COMPARISON;
+                token.atom = ATOM_NE;
             }
             else{
                 token.error = ERROR_INVALID_CHAR;
@@ -295,6 +358,7 @@ Token get_next_token(const char* input, int* pos) {
         
         case '<': case '>': 
             token.type = TOKEN_COMPARISON;
+            token.atom = c == '<' ? ATOM_LT : ATOM_GT;
             break;
         case ';':
             token.type = TOKEN_SEMICOLON;
@@ -319,6 +383,13 @@ Token get_next_token(const char* input, int* pos) {
     return token;
 }
 
+Token lexer_next(Lexer* lexer) {
+    Token token = lexer->engine == LEXER_DFA ? lexer_scan_dfa(lexer) : scan_token(lexer);
+    // A rejected operator still counts as an operator for the next check
+    lexer->last_type = (token.error == ERROR_CONSECUTIVE_OPERATORS) ? TOKEN_OPERATOR : token.type;
+    return token;
+}
+
 // int main(void) {
 //     const char *input = "int x = 123;\n"   // Basic declaration and number
 //                        "test_var = 456;\n"  // Identifier and assignment
@@ -329,12 +400,15 @@ Token get_next_token(const char* input, int* pos) {
 //                        "}";
 
 //     printf("Analyzing input:\n%s\n\n", input);
-//     int position = 0;
+//     Lexer lexer;
 //     Token token;
 
+//     InternTable atoms;
+//     intern_init(&atoms);
+//     lexer_init(&lexer, input, &atoms);
 //     do {
-//         token = get_next_token(input, &position);
-//         print_token(token);
+//         token = lexer_next(&lexer);
+//         print_token(NULL, input, token);
 //     } while (token.type != TOKEN_EOF);
 
 //     return 0;
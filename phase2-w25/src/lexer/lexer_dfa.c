@@ -0,0 +1,522 @@
+/* lexer_dfa.c */
+#include <string.h>
+
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+
+// Table-driven lexer: every byte is mapped to a character class and the
+// (state, class) pair looks up the next state, so the inner loop has a
+// single data-dependent branch (whether a final state was reached). It
+// accepts exactly the same language as the hand-written scan_token and
+// produces the same tokens.
+//
+// The tables below are generated; edit tools/gen_lexer_dfa.py instead.
+
+// BEGIN GENERATED by tools/gen_lexer_dfa.py
+enum {
+    C_OTHER,
+    C_NUL,
+    C_SPACE,
+    C_NEWLINE,
+    C_LETTER,
+    C_DIGIT,
+    C_DOT,
+    C_DQUOTE,
+    C_SQUOTE,
+    C_ARITH,
+    C_EQUALS,
+    C_BANG,
+    C_LTGT,
+    C_SEMICOLON,
+    C_LPAREN,
+    C_RPAREN,
+    C_LBRACE,
+    C_RBRACE,
+    CHAR_CLASS_COUNT
+};
+
+enum {
+    S_START,
+    S_IDENT,
+    S_INT,
+    S_FRAC,
+    S_STRING,
+    S_CHAR_OPEN,
+    S_CHAR_ONE,
+    S_CHAR_EXTRA,
+    S_EQUALS,
+    S_BANG,
+    S_BAD_NUMBER,
+    D_EOF,  // First final state
+    D_IDENT,
+    D_NUMBER,
+    D_BAD_NUMBER,
+    D_STRING,
+    D_STRING_OPEN,
+    D_CHAR,
+    D_CHAR_EMPTY,
+    D_CHAR_LONG,
+    D_CHAR_OPEN,
+    D_CHAR_LONG_OPEN,
+    D_ARITH,
+    D_ASSIGN,
+    D_EQEQ,
+    D_NOT_EQUALS,
+    D_BANG,
+    D_LTGT,
+    D_SEMICOLON,
+    D_LPAREN,
+    D_RPAREN,
+    D_LBRACE,
+    D_RBRACE,
+    D_INVALID,
+    STATE_COUNT
+};
+
+#define S_DONE D_EOF
+
+static const uint8_t char_class[256] = {
+    C_NUL, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_SPACE, C_NEWLINE, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_SPACE, C_BANG, C_DQUOTE, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_SQUOTE,
+    C_LPAREN, C_RPAREN, C_ARITH, C_ARITH, C_OTHER, C_ARITH, C_DOT, C_ARITH,
+    C_DIGIT, C_DIGIT, C_DIGIT, C_DIGIT, C_DIGIT, C_DIGIT, C_DIGIT, C_DIGIT,
+    C_DIGIT, C_DIGIT, C_OTHER, C_SEMICOLON, C_LTGT, C_EQUALS, C_LTGT, C_OTHER,
+    C_OTHER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER,
+    C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER,
+    C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER,
+    C_LETTER, C_LETTER, C_LETTER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_LETTER,
+    C_OTHER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER,
+    C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER,
+    C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER, C_LETTER,
+    C_LETTER, C_LETTER, C_LETTER, C_LBRACE, C_OTHER, C_RBRACE, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+    C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER, C_OTHER,
+};
+
+static const uint8_t transitions[S_DONE][CHAR_CLASS_COUNT] = {
+    [S_START] = {
+        [C_OTHER] = D_INVALID,
+        [C_NUL] = D_EOF,
+        [C_SPACE] = S_START,
+        [C_NEWLINE] = S_START,
+        [C_LETTER] = S_IDENT,
+        [C_DIGIT] = S_INT,
+        [C_DOT] = D_INVALID,
+        [C_DQUOTE] = S_STRING,
+        [C_SQUOTE] = S_CHAR_OPEN,
+        [C_ARITH] = D_ARITH,
+        [C_EQUALS] = S_EQUALS,
+        [C_BANG] = S_BANG,
+        [C_LTGT] = D_LTGT,
+        [C_SEMICOLON] = D_SEMICOLON,
+        [C_LPAREN] = D_LPAREN,
+        [C_RPAREN] = D_RPAREN,
+        [C_LBRACE] = D_LBRACE,
+        [C_RBRACE] = D_RBRACE,
+    },
+    [S_IDENT] = {
+        [C_OTHER] = D_IDENT,
+        [C_NUL] = D_IDENT,
+        [C_SPACE] = D_IDENT,
+        [C_NEWLINE] = D_IDENT,
+        [C_LETTER] = S_IDENT,
+        [C_DIGIT] = S_IDENT,
+        [C_DOT] = D_IDENT,
+        [C_DQUOTE] = D_IDENT,
+        [C_SQUOTE] = D_IDENT,
+        [C_ARITH] = D_IDENT,
+        [C_EQUALS] = D_IDENT,
+        [C_BANG] = D_IDENT,
+        [C_LTGT] = D_IDENT,
+        [C_SEMICOLON] = D_IDENT,
+        [C_LPAREN] = D_IDENT,
+        [C_RPAREN] = D_IDENT,
+        [C_LBRACE] = D_IDENT,
+        [C_RBRACE] = D_IDENT,
+    },
+    [S_INT] = {
+        [C_OTHER] = D_NUMBER,
+        [C_NUL] = D_NUMBER,
+        [C_SPACE] = D_NUMBER,
+        [C_NEWLINE] = D_NUMBER,
+        [C_LETTER] = D_NUMBER,
+        [C_DIGIT] = S_INT,
+        [C_DOT] = S_FRAC,
+        [C_DQUOTE] = D_NUMBER,
+        [C_SQUOTE] = D_NUMBER,
+        [C_ARITH] = D_NUMBER,
+        [C_EQUALS] = D_NUMBER,
+        [C_BANG] = D_NUMBER,
+        [C_LTGT] = D_NUMBER,
+        [C_SEMICOLON] = D_NUMBER,
+        [C_LPAREN] = D_NUMBER,
+        [C_RPAREN] = D_NUMBER,
+        [C_LBRACE] = D_NUMBER,
+        [C_RBRACE] = D_NUMBER,
+    },
+    [S_FRAC] = {
+        [C_OTHER] = D_NUMBER,
+        [C_NUL] = D_NUMBER,
+        [C_SPACE] = D_NUMBER,
+        [C_NEWLINE] = D_NUMBER,
+        [C_LETTER] = D_NUMBER,
+        [C_DIGIT] = S_FRAC,
+        [C_DOT] = S_BAD_NUMBER,
+        [C_DQUOTE] = D_NUMBER,
+        [C_SQUOTE] = D_NUMBER,
+        [C_ARITH] = D_NUMBER,
+        [C_EQUALS] = D_NUMBER,
+        [C_BANG] = D_NUMBER,
+        [C_LTGT] = D_NUMBER,
+        [C_SEMICOLON] = D_NUMBER,
+        [C_LPAREN] = D_NUMBER,
+        [C_RPAREN] = D_NUMBER,
+        [C_LBRACE] = D_NUMBER,
+        [C_RBRACE] = D_NUMBER,
+    },
+    [S_STRING] = {
+        [C_OTHER] = S_STRING,
+        [C_NUL] = D_STRING_OPEN,
+        [C_SPACE] = S_STRING,
+        [C_NEWLINE] = S_STRING,
+        [C_LETTER] = S_STRING,
+        [C_DIGIT] = S_STRING,
+        [C_DOT] = S_STRING,
+        [C_DQUOTE] = D_STRING,
+        [C_SQUOTE] = S_STRING,
+        [C_ARITH] = S_STRING,
+        [C_EQUALS] = S_STRING,
+        [C_BANG] = S_STRING,
+        [C_LTGT] = S_STRING,
+        [C_SEMICOLON] = S_STRING,
+        [C_LPAREN] = S_STRING,
+        [C_RPAREN] = S_STRING,
+        [C_LBRACE] = S_STRING,
+        [C_RBRACE] = S_STRING,
+    },
+    [S_CHAR_OPEN] = {
+        [C_OTHER] = S_CHAR_ONE,
+        [C_NUL] = D_CHAR_OPEN,
+        [C_SPACE] = S_CHAR_ONE,
+        [C_NEWLINE] = S_CHAR_ONE,
+        [C_LETTER] = S_CHAR_ONE,
+        [C_DIGIT] = S_CHAR_ONE,
+        [C_DOT] = S_CHAR_ONE,
+        [C_DQUOTE] = S_CHAR_ONE,
+        [C_SQUOTE] = D_CHAR_EMPTY,
+        [C_ARITH] = S_CHAR_ONE,
+        [C_EQUALS] = S_CHAR_ONE,
+        [C_BANG] = S_CHAR_ONE,
+        [C_LTGT] = S_CHAR_ONE,
+        [C_SEMICOLON] = S_CHAR_ONE,
+        [C_LPAREN] = S_CHAR_ONE,
+        [C_RPAREN] = S_CHAR_ONE,
+        [C_LBRACE] = S_CHAR_ONE,
+        [C_RBRACE] = S_CHAR_ONE,
+    },
+    [S_CHAR_ONE] = {
+        [C_OTHER] = S_CHAR_EXTRA,
+        [C_NUL] = D_CHAR_OPEN,
+        [C_SPACE] = S_CHAR_EXTRA,
+        [C_NEWLINE] = S_CHAR_EXTRA,
+        [C_LETTER] = S_CHAR_EXTRA,
+        [C_DIGIT] = S_CHAR_EXTRA,
+        [C_DOT] = S_CHAR_EXTRA,
+        [C_DQUOTE] = S_CHAR_EXTRA,
+        [C_SQUOTE] = D_CHAR,
+        [C_ARITH] = S_CHAR_EXTRA,
+        [C_EQUALS] = S_CHAR_EXTRA,
+        [C_BANG] = S_CHAR_EXTRA,
+        [C_LTGT] = S_CHAR_EXTRA,
+        [C_SEMICOLON] = S_CHAR_EXTRA,
+        [C_LPAREN] = S_CHAR_EXTRA,
+        [C_RPAREN] = S_CHAR_EXTRA,
+        [C_LBRACE] = S_CHAR_EXTRA,
+        [C_RBRACE] = S_CHAR_EXTRA,
+    },
+    [S_CHAR_EXTRA] = {
+        [C_OTHER] = S_CHAR_EXTRA,
+        [C_NUL] = D_CHAR_LONG_OPEN,
+        [C_SPACE] = S_CHAR_EXTRA,
+        [C_NEWLINE] = S_CHAR_EXTRA,
+        [C_LETTER] = S_CHAR_EXTRA,
+        [C_DIGIT] = S_CHAR_EXTRA,
+        [C_DOT] = S_CHAR_EXTRA,
+        [C_DQUOTE] = S_CHAR_EXTRA,
+        [C_SQUOTE] = D_CHAR_LONG,
+        [C_ARITH] = S_CHAR_EXTRA,
+        [C_EQUALS] = S_CHAR_EXTRA,
+        [C_BANG] = S_CHAR_EXTRA,
+        [C_LTGT] = S_CHAR_EXTRA,
+        [C_SEMICOLON] = S_CHAR_EXTRA,
+        [C_LPAREN] = S_CHAR_EXTRA,
+        [C_RPAREN] = S_CHAR_EXTRA,
+        [C_LBRACE] = S_CHAR_EXTRA,
+        [C_RBRACE] = S_CHAR_EXTRA,
+    },
+    [S_EQUALS] = {
+        [C_OTHER] = D_ASSIGN,
+        [C_NUL] = D_ASSIGN,
+        [C_SPACE] = D_ASSIGN,
+        [C_NEWLINE] = D_ASSIGN,
+        [C_LETTER] = D_ASSIGN,
+        [C_DIGIT] = D_ASSIGN,
+        [C_DOT] = D_ASSIGN,
+        [C_DQUOTE] = D_ASSIGN,
+        [C_SQUOTE] = D_ASSIGN,
+        [C_ARITH] = D_ASSIGN,
+        [C_EQUALS] = D_EQEQ,
+        [C_BANG] = D_ASSIGN,
+        [C_LTGT] = D_ASSIGN,
+        [C_SEMICOLON] = D_ASSIGN,
+        [C_LPAREN] = D_ASSIGN,
+        [C_RPAREN] = D_ASSIGN,
+        [C_LBRACE] = D_ASSIGN,
+        [C_RBRACE] = D_ASSIGN,
+    },
+    [S_BANG] = {
+        [C_OTHER] = D_BANG,
+        [C_NUL] = D_BANG,
+        [C_SPACE] = D_BANG,
+        [C_NEWLINE] = D_BANG,
+        [C_LETTER] = D_BANG,
+        [C_DIGIT] = D_BANG,
+        [C_DOT] = D_BANG,
+        [C_DQUOTE] = D_BANG,
+        [C_SQUOTE] = D_BANG,
+        [C_ARITH] = D_BANG,
+        [C_EQUALS] = D_NOT_EQUALS,
+        [C_BANG] = D_BANG,
+        [C_LTGT] = D_BANG,
+        [C_SEMICOLON] = D_BANG,
+        [C_LPAREN] = D_BANG,
+        [C_RPAREN] = D_BANG,
+        [C_LBRACE] = D_BANG,
+        [C_RBRACE] = D_BANG,
+    },
+    [S_BAD_NUMBER] = {
+        [C_OTHER] = D_BAD_NUMBER,
+        [C_NUL] = D_BAD_NUMBER,
+        [C_SPACE] = D_BAD_NUMBER,
+        [C_NEWLINE] = D_BAD_NUMBER,
+        [C_LETTER] = D_BAD_NUMBER,
+        [C_DIGIT] = S_BAD_NUMBER,
+        [C_DOT] = S_BAD_NUMBER,
+        [C_DQUOTE] = D_BAD_NUMBER,
+        [C_SQUOTE] = D_BAD_NUMBER,
+        [C_ARITH] = D_BAD_NUMBER,
+        [C_EQUALS] = D_BAD_NUMBER,
+        [C_BANG] = D_BAD_NUMBER,
+        [C_LTGT] = D_BAD_NUMBER,
+        [C_SEMICOLON] = D_BAD_NUMBER,
+        [C_LPAREN] = D_BAD_NUMBER,
+        [C_RPAREN] = D_BAD_NUMBER,
+        [C_LBRACE] = D_BAD_NUMBER,
+        [C_RBRACE] = D_BAD_NUMBER,
+    },
+};
+
+// 1 when reaching the final state does not consume the last byte read
+static const uint8_t gives_back[STATE_COUNT] = {
+    [D_EOF] = 1,
+    [D_IDENT] = 1,
+    [D_NUMBER] = 1,
+    [D_BAD_NUMBER] = 1,
+    [D_STRING] = 0,
+    [D_STRING_OPEN] = 1,
+    [D_CHAR] = 0,
+    [D_CHAR_EMPTY] = 0,
+    [D_CHAR_LONG] = 0,
+    [D_CHAR_OPEN] = 1,
+    [D_CHAR_LONG_OPEN] = 1,
+    [D_ARITH] = 0,
+    [D_ASSIGN] = 1,
+    [D_EQEQ] = 0,
+    [D_NOT_EQUALS] = 0,
+    [D_BANG] = 1,
+    [D_LTGT] = 0,
+    [D_SEMICOLON] = 0,
+    [D_LPAREN] = 0,
+    [D_RPAREN] = 0,
+    [D_LBRACE] = 0,
+    [D_RBRACE] = 0,
+    [D_INVALID] = 0,
+};
+// END GENERATED
+
+// Keywords, placed by a perfect hash of (length, first byte, last byte)
+#define KEYWORD_SLOTS 16
+
+static inline unsigned keyword_hash(const char* text, size_t length) {
+    return (unsigned)(length + (unsigned char)text[0] * 14 + (unsigned char)text[length - 1] * 12) & (KEYWORD_SLOTS - 1);
+}
+
+static const struct {
+    const char* text;
+    uint8_t length;
+    uint8_t type;
+    Atom atom;
+} keywords[KEYWORD_SLOTS] = {
+    [0] = {"bool", 4, TOKEN_BOOL, ATOM_BOOL},
+    [1] = {"int", 3, TOKEN_INT, ATOM_INT},
+    [2] = {"repeat", 6, TOKEN_REPEAT, ATOM_REPEAT},
+    [3] = {"while", 5, TOKEN_WHILE, ATOM_WHILE},
+    [4] = {"string", 6, TOKEN_STRING, ATOM_STRING},
+    [5] = {"print", 5, TOKEN_PRINT, ATOM_PRINT},
+    [6] = {"char", 4, TOKEN_CHAR, ATOM_CHAR},
+    [8] = {"if", 2, TOKEN_IF, ATOM_IF},
+    [9] = {"float", 5, TOKEN_FLOAT, ATOM_FLOAT},
+    [11] = {"until", 5, TOKEN_UNTIL, ATOM_UNTIL},
+    [13] = {"factorial", 9, TOKEN_FACTORIAL, ATOM_FACTORIAL},
+    [14] = {"do", 2, TOKEN_DO, ATOM_DO},
+};
+
+Token lexer_scan_dfa(Lexer* lexer) {
+    const char* input = lexer->source;
+    Token token = {TOKEN_ERROR, ERROR_NONE, 0, 0, 0, ATOM_NONE};
+    size_t pos = lexer->pos;
+    size_t start;
+    size_t line_start = lexer->line_start;
+    int line = lexer->line;
+    unsigned state;
+    unsigned char c;
+
+    // Whitespace before the token: the only bytes that keep S_START
+    for (;;) {
+        c = (unsigned char)input[pos++];
+        state = transitions[S_START][char_class[c]];
+        if (state != S_START) break;
+        if (c == '\n') {
+            line++;
+            line_start = pos;
+        }
+    }
+    start = pos - 1;
+    token.line = line;
+
+    // The token itself
+    while (state < S_DONE) {
+        c = (unsigned char)input[pos++];
+        unsigned next = transitions[state][char_class[c]];
+        // A newline handed back to the next token is counted by that token
+        int newline = (c == '\n') & (next < S_DONE);
+        line += newline;
+        line_start = newline ? pos : line_start;
+        state = next;
+    }
+    pos -= gives_back[state];
+
+    lexer->pos = pos;
+    lexer->line = line;
+    lexer->line_start = line_start;
+    token.offset = start;
+    token.length = pos - start;
+
+    switch (state) {
+        case D_EOF:
+            token.type = TOKEN_EOF;
+            break;
+        case D_IDENT: {
+            unsigned slot = keyword_hash(input + start, token.length);
+            if (keywords[slot].length == token.length &&
+                memcmp(keywords[slot].text, input + start, token.length) == 0) {
+                token.type = keywords[slot].type;
+                token.atom = keywords[slot].atom;
+            } else {
+                token.type = TOKEN_IDENTIFIER;
+                token.atom = intern(lexer->atoms, input + start, token.length);
+            }
+            break;
+        }
+        case D_NUMBER:
+            lexer_number(lexer, &token);
+            break;
+        case D_BAD_NUMBER:
+            token.error = ERROR_INVALID_NUMBER;
+            break;
+        case D_STRING:
+        case D_STRING_OPEN:
+            // The lexeme is the text between the quotes
+            token.offset = start + 1;
+            token.length = pos - start - (state == D_STRING ? 2 : 1);
+            token.atom = intern(lexer->atoms, input + token.offset, token.length);
+            if (state == D_STRING) {
+                token.type = TOKEN_STRING;
+            } else {
+                token.error = ERROR_INVALID_CHAR;
+            }
+            break;
+        case D_CHAR_LONG:
+        case D_CHAR_LONG_OPEN:
+            if (!lexer->quiet) print_char_length_warning(lexer->out, input[start + 1]);
+            // fall through
+        case D_CHAR:
+        case D_CHAR_EMPTY:
+        case D_CHAR_OPEN:
+            // The lexeme is the first character after the quote, if any
+            token.offset = start + 1;
+            token.length = state == D_CHAR_EMPTY || (state == D_CHAR_OPEN && pos == start + 1) ? 0 : 1;
+            if (state == D_CHAR_OPEN || state == D_CHAR_LONG_OPEN) {
+                token.error = ERROR_INVALID_CHAR;
+            } else {
+                token.type = TOKEN_CHAR;
+                token.atom = intern(lexer->atoms, input + token.offset, token.length);
+            }
+            break;
+        case D_ARITH:
+            if (lexer->last_type == TOKEN_OPERATOR) {
+                token.error = ERROR_CONSECUTIVE_OPERATORS;
+                break;
+            }
+            token.type = TOKEN_OPERATOR;
+            switch (input[start]) {
+                case '+': token.atom = ATOM_PLUS; break;
+                case '-': token.atom = ATOM_MINUS; break;
+                case '*': token.atom = ATOM_STAR; break;
+                default:  token.atom = ATOM_SLASH; break;
+            }
+            break;
+        case D_ASSIGN:
+            token.type = TOKEN_EQUALS;
+            break;
+        case D_EQEQ:
+            token.type = TOKEN_COMPARISON;
+            token.atom = ATOM_EQ;
+            break;
+        case D_NOT_EQUALS:
+            token.type = TOKEN_COMPARISON;
+            token.atom = ATOM_NE;
+            break;
+        case D_LTGT:
+            token.type = TOKEN_COMPARISON;
+            token.atom = input[start] == '<' ? ATOM_LT : ATOM_GT;
+            break;
+        case D_SEMICOLON: token.type = TOKEN_SEMICOLON; break;
+        case D_LPAREN:    token.type = TOKEN_LPAREN; break;
+        case D_RPAREN:    token.type = TOKEN_RPAREN; break;
+        case D_LBRACE:    token.type = TOKEN_LBRACE; break;
+        case D_RBRACE:    token.type = TOKEN_RBRACE; break;
+        default:
+            // D_BANG and D_INVALID
+            token.error = ERROR_INVALID_CHAR;
+            break;
+    }
+    return token;
+}
@@ -0,0 +1,292 @@
+/* parallel.c */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/lexer.h"
+
+// Parallel batch lexing. The input is cut into chunks just after newlines
+// and every chunk is lexed speculatively on its own thread, as if a token
+// started at the chunk's first byte, with line numbers counted from 1 and
+// its own intern table. A chunk stops at the first token that starts at or
+// past its end, so the last token it lexes may run into the next chunk
+// (a string or char literal that spans the cut).
+//
+// The chunks are then merged in order by following the true lexer state:
+// where the true lexer is about to start a token at a position where the
+// next chunk also started one, the rest of that chunk is spliced in (with
+// its lines shifted and atoms re-interned); tokens before that point are
+// relexed. Relexing is only needed after a literal crossed a cut. The
+// merged stream, atom numbering and warnings match a sequential lex_all.
+
+// Smallest chunk worth a thread of its own
+#ifndef PARALLEL_MIN_CHUNK
+#define PARALLEL_MIN_CHUNK (256 * 1024)
+#endif
+#define CHUNK_INITIAL_TOKENS 1024
+// Same estimate as lex_all, to size each chunk's buffers up front
+#define CHUNK_BYTES_PER_TOKEN 6
+
+typedef struct {
+    Lexer lexer;               // Speculative lexer for this chunk
+    InternTable atoms;         // Atoms of this chunk's tokens
+    size_t begin;              // Chunk is source[begin, end)
+    size_t end;
+    TokenBuffer tokens;        // Speculative tokens, lines relative to `begin`
+    uint32_t* starts;          // Offset where each token starts (before any quote)
+    uint32_t* warnings;        // Tokens that printed a char length warning
+    uint32_t warning_count;
+    uint32_t warning_capacity;
+    int newlines;              // '\n' bytes in [begin, end)
+    int ok;                    // 0 if out of memory
+} Chunk;
+
+static int chunk_push(Chunk* chunk, Token token, size_t start) {
+    TokenBuffer* tokens = &chunk->tokens;
+    if (tokens->count == tokens->capacity) {
+        uint32_t capacity = tokens->capacity * 2;
+        uint32_t* starts = realloc(chunk->starts, capacity * sizeof(*starts));
+        if (!starts) return 0;
+        chunk->starts = starts;
+        if (!token_buffer_reserve(tokens, capacity)) return 0;
+    }
+    uint32_t i = tokens->count++;
+    tokens->types[i] = token.type;
+    tokens->errors[i] = token.error;
+    tokens->offsets[i] = token.offset;
+    tokens->lengths[i] = token.length;
+    tokens->lines[i] = token.line;
+    tokens->atoms[i] = token.atom;
+    chunk->starts[i] = start;
+    return 1;
+}
+
+static int chunk_warn(Chunk* chunk, uint32_t index) {
+    if (chunk->warning_count == chunk->warning_capacity) {
+        uint32_t capacity = chunk->warning_capacity ? chunk->warning_capacity * 2 : 16;
+        uint32_t* warnings = realloc(chunk->warnings, capacity * sizeof(*warnings));
+        if (!warnings) return 0;
+        chunk->warnings = warnings;
+        chunk->warning_capacity = capacity;
+    }
+    chunk->warnings[chunk->warning_count++] = index;
+    return 1;
+}
+
+static void* lex_chunk(void* arg) {
+    Chunk* chunk = arg;
+    Lexer* lexer = &chunk->lexer;
+    const char* source = lexer->source;
+    Token token;
+
+    for (const char* p = source + chunk->begin; (p = memchr(p, '\n', source + chunk->end - p)); p++) {
+        chunk->newlines++;
+    }
+
+    chunk->ok = 0;
+    uint32_t estimate = (chunk->end - chunk->begin) / CHUNK_BYTES_PER_TOKEN + 1;
+    chunk->starts = malloc(estimate * sizeof(*chunk->starts));
+    if (!chunk->starts || !token_buffer_reserve(&chunk->tokens, estimate)) return NULL;
+    for (;;) {
+        lexer->pos = lexer->scan->skip_space(source, lexer->pos, &lexer->line, &lexer->line_start);
+        size_t start = lexer->pos;
+        // The next chunk lexes tokens that start in it (the last chunk runs to EOF)
+        if (start >= chunk->end && source[start] != '\0') break;
+        token = lexer_next(lexer);
+        if (!chunk_push(chunk, token, start)) return NULL;
+        if (lexer_warned_char_length(source, start, token) && !chunk_warn(chunk, chunk->tokens.count - 1)) {
+            return NULL;
+        }
+        if (token.type == TOKEN_EOF) break;
+    }
+    chunk->ok = 1;
+    return NULL;
+}
+
+// Append chunk tokens [from, count) to `out`, moving lines and atoms into
+// the caller's numbering. `lexer` holds the true state before token `from`.
+static int splice(Chunk* chunk, uint32_t from, int first_line, Lexer* lexer, TokenBuffer* out) {
+    const TokenBuffer* in = &chunk->tokens;
+    const char* source = lexer->source;
+    uint32_t count = in->count - from;
+    uint32_t at = out->count;
+    if (count == 0) return 1;
+    if (out->count + count > out->capacity &&
+        !token_buffer_reserve(out, out->count + count + out->count / 2)) {
+        return 0;
+    }
+
+    Atom* remap = calloc(chunk->atoms.count, sizeof(Atom));
+    if (!remap) return 0;
+
+    memcpy(out->types + at, in->types + from, count * sizeof(*in->types));
+    memcpy(out->errors + at, in->errors + from, count * sizeof(*in->errors));
+    memcpy(out->offsets + at, in->offsets + from, count * sizeof(*in->offsets));
+    memcpy(out->lengths + at, in->lengths + from, count * sizeof(*in->lengths));
+    for (uint32_t i = 0; i < count; i++) {
+        out->lines[at + i] = in->lines[from + i] + first_line - 1;
+    }
+
+    // The first token was lexed without knowing the previous token; only
+    // the consecutive-operator check depends on it
+    if (in->types[from] == TOKEN_OPERATOR || in->errors[from] == ERROR_CONSECUTIVE_OPERATORS) {
+        if (lexer->last_type == TOKEN_OPERATOR) {
+            out->types[at] = TOKEN_ERROR;
+            out->errors[at] = ERROR_CONSECUTIVE_OPERATORS;
+        } else {
+            out->types[at] = TOKEN_OPERATOR;
+            out->errors[at] = ERROR_NONE;
+        }
+    }
+
+    // Interning in token order keeps atom numbers the same as sequential lexing
+    uint32_t warning = 0;
+    while (warning < chunk->warning_count && chunk->warnings[warning] < from) warning++;
+    for (uint32_t i = 0; i < count; i++) {
+        Atom atom = in->atoms[from + i];
+        if (i == 0 && out->errors[at] == ERROR_CONSECUTIVE_OPERATORS) {
+            atom = ATOM_NONE;
+        } else if (i == 0 && out->types[at] == TOKEN_OPERATOR) {
+            char c = source[out->offsets[at]];
+            atom = c == '+' ? ATOM_PLUS : c == '-' ? ATOM_MINUS : c == '*' ? ATOM_STAR : ATOM_SLASH;
+        } else if (atom >= ATOM_PREDEFINED_COUNT) {
+            if (remap[atom] == ATOM_NONE) {
+                remap[atom] = intern(lexer->atoms, atom_text(&chunk->atoms, atom), atom_length(&chunk->atoms, atom));
+                // Number literals keep the value decoded by the chunk
+                if (remap[atom] != ATOM_NONE && lexer->atoms->numbers[remap[atom]].kind == NUMBER_NONE) {
+                    lexer->atoms->numbers[remap[atom]] = chunk->atoms.numbers[atom];
+                }
+            }
+            atom = remap[atom];
+        }
+        out->atoms[at + i] = atom;
+        if (warning < chunk->warning_count && chunk->warnings[warning] == from + i) {
+            if (!lexer->quiet) print_char_length_warning(lexer->out, source[out->offsets[at + i]]);
+            warning++;
+        }
+    }
+    free(remap);
+    out->count += count;
+
+    uint32_t last = out->count - 1;
+    lexer->last_type = out->errors[last] == ERROR_CONSECUTIVE_OPERATORS ? TOKEN_OPERATOR : out->types[last];
+    lexer->pos = chunk->lexer.pos;
+    lexer->line = chunk->lexer.line + first_line - 1;
+    lexer->line_start = chunk->lexer.line_start;
+    return 1;
+}
+
+static int push_token(TokenBuffer* buffer, Token token) {
+    if (buffer->count == buffer->capacity &&
+        !token_buffer_reserve(buffer, buffer->capacity ? buffer->capacity * 2 : CHUNK_INITIAL_TOKENS)) {
+        return 0;
+    }
+    uint32_t i = buffer->count++;
+    buffer->types[i] = token.type;
+    buffer->errors[i] = token.error;
+    buffer->offsets[i] = token.offset;
+    buffer->lengths[i] = token.length;
+    buffer->lines[i] = token.line;
+    buffer->atoms[i] = token.atom;
+    return 1;
+}
+
+// Follow the true lexer state through the chunks, splicing and relexing
+static int merge(Chunk* chunks, int count, Lexer* lexer, TokenBuffer* out) {
+    int first_line = lexer->line;
+    for (int k = 0; k < count; k++) {
+        Chunk* chunk = &chunks[k];
+        const uint32_t* starts = chunk->starts;
+        uint32_t next = 0;
+        for (;;) {
+            lexer->pos = lexer->scan->skip_space(lexer->source, lexer->pos, &lexer->line, &lexer->line_start);
+            while (next < chunk->tokens.count && starts[next] < lexer->pos) next++;
+            if (next < chunk->tokens.count && starts[next] == lexer->pos) {
+                if (!splice(chunk, next, first_line, lexer, out)) return 0;
+                // A literal left open runs to the end of the input, so
+                // this chunk already ends with the EOF the later ones hold
+                if (out->types[out->count - 1] == TOKEN_EOF) return 1;
+                break;
+            }
+            if (k + 1 < count && lexer->pos >= chunk->end) break;
+            Token token = lexer_next(lexer);
+            if (!push_token(out, token)) return 0;
+            if (token.type == TOKEN_EOF) return 1;
+        }
+        first_line += chunk->newlines;
+    }
+    return 1;
+}
+
+int lex_all_parallel(Lexer* lexer, TokenBuffer* buffer, int threads) {
+    const char* source = lexer->source;
+    size_t origin = lexer->pos;
+    size_t begin = origin;
+    size_t size = begin + strlen(source + begin);
+    size_t per_chunk;
+
+    if (threads > 1 && (size - begin) / threads < PARALLEL_MIN_CHUNK) {
+        threads = (int)((size - begin) / PARALLEL_MIN_CHUNK);
+    }
+    if (threads <= 1 || size >= UINT32_MAX) return lex_all(lexer, buffer);
+    per_chunk = (size - begin) / threads;
+
+    Chunk* chunks = calloc(threads, sizeof(Chunk));
+    pthread_t* workers = calloc(threads, sizeof(pthread_t));
+    int* started = calloc(threads, sizeof(int));
+    int count = 0;
+    int ok = chunks && workers && started;
+
+    // Cut just after the first newline at or past each even split point
+    for (int k = 0; ok && k < threads && begin < size; k++) {
+        Chunk* chunk = &chunks[count++];
+        size_t split = origin + (k + 1) * per_chunk;
+        size_t end = size;
+        if (split < begin) split = begin;
+        if (k + 1 < threads && split < size) {
+            const char* newline = memchr(source + split, '\n', size - split);
+            if (newline) end = newline - source + 1;
+        }
+        chunk->begin = begin;
+        chunk->end = end;
+        chunk->lexer = *lexer;
+        chunk->lexer.pos = begin;
+        chunk->lexer.line = 1;
+        chunk->lexer.line_start = k == 0 ? lexer->line_start : begin;
+        chunk->lexer.last_type = TOKEN_EOF;
+        chunk->lexer.quiet = 1;
+        chunk->lexer.atoms = &chunk->atoms;
+        if (!intern_init(&chunk->atoms)) ok = 0;
+        token_buffer_init(&chunk->tokens);
+        begin = end;
+    }
+
+    for (int k = 1; ok && k < count; k++) {
+        started[k] = pthread_create(&workers[k], NULL, lex_chunk, &chunks[k]) == 0;
+        // Without a thread the chunk is lexed below on this one
+        if (!started[k]) lex_chunk(&chunks[k]);
+    }
+    if (ok && count > 0) lex_chunk(&chunks[0]);
+    for (int k = 1; k < count; k++) {
+        if (started[k]) pthread_join(workers[k], NULL);
+        if (!chunks[k].ok) ok = 0;
+    }
+    if (count > 0 && !chunks[0].ok) ok = 0;
+
+    if (ok) {
+        uint32_t total = buffer->count;
+        for (int k = 0; k < count; k++) total += chunks[k].tokens.count;
+        ok = token_buffer_reserve(buffer, total) && merge(chunks, count, lexer, buffer);
+    }
+
+    for (int k = 0; k < count; k++) {
+        intern_free(&chunks[k].atoms);
+        token_buffer_free(&chunks[k].tokens);
+        free(chunks[k].starts);
+        free(chunks[k].warnings);
+    }
+    free(chunks);
+    free(workers);
+    free(started);
+    return ok;
+}
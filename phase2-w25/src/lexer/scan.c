@@ -0,0 +1,325 @@
+/* scan.c */
+#include <stdint.h>
+
+#include "../../include/scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar fallback
+// ---------------------------------------------------------------------------
+
+static size_t skip_space_scalar(const char* s, size_t pos, int* lines, size_t* line_start) {
+    char c;
+    while ((c = s[pos]) == ' ' || c == '\t' || c == '\n') {
+        pos++;
+        if (c == '\n') {
+            (*lines)++;
+            *line_start = pos;
+        }
+    }
+    return pos;
+}
+
+static size_t skip_ident_scalar(const char* s, size_t pos) {
+    while (scan_is_ident(s[pos])) pos++;
+    return pos;
+}
+
+static size_t skip_digits_scalar(const char* s, size_t pos) {
+    while (scan_is_digit(s[pos])) pos++;
+    return pos;
+}
+
+static size_t skip_quoted_scalar(const char* s, size_t pos, char quote, int* lines, size_t* line_start) {
+    char c;
+    while ((c = s[pos]) != quote && c != '\0') {
+        pos++;
+        if (c == '\n') {
+            (*lines)++;
+            *line_start = pos;
+        }
+    }
+    return pos;
+}
+
+static const ScanOps scalar_ops = {
+    "scalar", skip_space_scalar, skip_ident_scalar, skip_digits_scalar, skip_quoted_scalar
+};
+
+const ScanOps* scan_ops_scalar(void) {
+    return &scalar_ops;
+}
+
+#ifdef SCAN_X86
+
+// The vector scanners use aligned loads. An aligned block never crosses a
+// page boundary, so reading the whole block that holds the NUL terminator
+// is safe even though it may extend past the end of the buffer. The bytes
+// before `pos` in the first block are masked off.
+
+// Most runs in real programs are only a few bytes long (a single space, a
+// short name), so the vector scanners first look at a few bytes one at a
+// time and only switch to block scanning for longer runs.
+#define SCALAR_PROLOGUE 8
+
+// Record the newlines in `nl` (a bitmask of block offsets) that precede the
+// stop position `stop` (number of valid bits).
+static inline void count_newlines(uint32_t nl, unsigned stop, size_t block, int* lines, size_t* line_start) {
+    if (stop < 32) nl &= (1u << stop) - 1;
+    if (nl) {
+        *lines += __builtin_popcount(nl);
+        *line_start = block + 32 - __builtin_clz(nl);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2: 16 bytes per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static inline __m128i in_range_sse2(__m128i x, char lo, char hi) {
+    // Shift [lo, hi] down to the bottom of the signed range, then one compare
+    __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(-128 - lo)));
+    return _mm_cmpgt_epi8(_mm_set1_epi8((char)(-128 + (hi - lo) + 1)), shifted);
+}
+
+__attribute__((target("sse2")))
+static inline uint32_t ident_mask_sse2(__m128i x) {
+    __m128i alpha = in_range_sse2(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i digit = in_range_sse2(x, '0', '9');
+    __m128i under = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+__attribute__((target("sse2")))
+static inline uint32_t digit_mask_sse2(__m128i x) {
+    return (uint32_t)_mm_movemask_epi8(in_range_sse2(x, '0', '9'));
+}
+
+// Shared block walk: `stop_mask` yields the bytes that end the run
+#define SSE2_WALK(s, pos, MASK_EXPR, IS_RUN)                                 \
+    for (int i = 0; i < SCALAR_PROLOGUE; i++, (pos)++) {                     \
+        if (!IS_RUN((s)[pos])) return (pos);                                 \
+    }                                                                        \
+    const char* p = (const char*)((uintptr_t)((s) + (pos)) & ~(uintptr_t)15); \
+    uint32_t stop;                                                           \
+    {                                                                        \
+        __m128i x = _mm_load_si128((const __m128i*)p);                       \
+        stop = (MASK_EXPR) & (0xFFFFu << ((s) + (pos) - p));                 \
+    }                                                                        \
+    while (!stop) {                                                          \
+        p += 16;                                                             \
+        __m128i x = _mm_load_si128((const __m128i*)p);                       \
+        stop = (MASK_EXPR);                                                  \
+    }                                                                        \
+    return (size_t)(p - (s)) + __builtin_ctz(stop)
+
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t skip_ident_sse2(const char* s, size_t pos) {
+    SSE2_WALK(s, pos, ~ident_mask_sse2(x) & 0xFFFFu, scan_is_ident);
+}
+
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t skip_digits_sse2(const char* s, size_t pos) {
+    SSE2_WALK(s, pos, ~digit_mask_sse2(x) & 0xFFFFu, scan_is_digit);
+}
+
+#undef SSE2_WALK
+
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t skip_space_sse2(const char* s, size_t pos, int* lines, size_t* line_start) {
+    for (int i = 0; i < SCALAR_PROLOGUE; i++, pos++) {
+        char c = s[pos];
+        if (c == '\n') {
+            (*lines)++;
+            *line_start = pos + 1;
+        } else if (c != ' ' && c != '\t') {
+            return pos;
+        }
+    }
+    const char* p = (const char*)((uintptr_t)(s + pos) & ~(uintptr_t)15);
+    uint32_t valid = 0xFFFFu << (s + pos - p);
+    for (;;) {
+        __m128i x = _mm_load_si128((const __m128i*)p);
+        __m128i nl = _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'));
+        __m128i ws = _mm_or_si128(nl, _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                                                   _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))));
+        uint32_t nl_mask = (uint32_t)_mm_movemask_epi8(nl) & valid;
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(ws) & valid & 0xFFFFu;
+        unsigned end = stop ? (unsigned)__builtin_ctz(stop) : 16;
+        count_newlines(nl_mask, end, (size_t)(p - s), lines, line_start);
+        if (stop) return (size_t)(p - s) + end;
+        p += 16;
+        valid = 0xFFFFu;
+    }
+}
+
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t skip_quoted_sse2(const char* s, size_t pos, char quote, int* lines, size_t* line_start) {
+    for (int i = 0; i < SCALAR_PROLOGUE; i++, pos++) {
+        char c = s[pos];
+        if (c == quote || c == '\0') return pos;
+        if (c == '\n') {
+            (*lines)++;
+            *line_start = pos + 1;
+        }
+    }
+    const char* p = (const char*)((uintptr_t)(s + pos) & ~(uintptr_t)15);
+    uint32_t valid = 0xFFFFu << (s + pos - p);
+    for (;;) {
+        __m128i x = _mm_load_si128((const __m128i*)p);
+        __m128i end_bytes = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(quote)),
+                                         _mm_cmpeq_epi8(x, _mm_setzero_si128()));
+        uint32_t nl_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))) & valid;
+        uint32_t stop = (uint32_t)_mm_movemask_epi8(end_bytes) & valid;
+        unsigned end = stop ? (unsigned)__builtin_ctz(stop) : 16;
+        count_newlines(nl_mask, end, (size_t)(p - s), lines, line_start);
+        if (stop) return (size_t)(p - s) + end;
+        p += 16;
+        valid = 0xFFFFu;
+    }
+}
+
+static const ScanOps sse2_ops = {
+    "sse2", skip_space_sse2, skip_ident_sse2, skip_digits_sse2, skip_quoted_sse2
+};
+
+// ---------------------------------------------------------------------------
+// AVX2: 32 bytes per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static inline __m256i in_range_avx2(__m256i x, char lo, char hi) {
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(-128 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + (hi - lo) + 1)), shifted);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t ident_mask_avx2(__m256i x) {
+    __m256i alpha = in_range_avx2(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i digit = in_range_avx2(x, '0', '9');
+    __m256i under = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t digit_mask_avx2(__m256i x) {
+    return (uint32_t)_mm256_movemask_epi8(in_range_avx2(x, '0', '9'));
+}
+
+#define AVX2_WALK(s, pos, MASK_EXPR, IS_RUN)                                 \
+    for (int i = 0; i < SCALAR_PROLOGUE; i++, (pos)++) {                     \
+        if (!IS_RUN((s)[pos])) return (pos);                                 \
+    }                                                                        \
+    const char* p = (const char*)((uintptr_t)((s) + (pos)) & ~(uintptr_t)31); \
+    uint32_t stop;                                                           \
+    {                                                                        \
+        __m256i x = _mm256_load_si256((const __m256i*)p);                    \
+        stop = (MASK_EXPR) & (0xFFFFFFFFu << ((s) + (pos) - p));             \
+    }                                                                        \
+    while (!stop) {                                                          \
+        p += 32;                                                             \
+        __m256i x = _mm256_load_si256((const __m256i*)p);                    \
+        stop = (MASK_EXPR);                                                  \
+    }                                                                        \
+    return (size_t)(p - (s)) + __builtin_ctz(stop)
+
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t skip_ident_avx2(const char* s, size_t pos) {
+    AVX2_WALK(s, pos, ~ident_mask_avx2(x), scan_is_ident);
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t skip_digits_avx2(const char* s, size_t pos) {
+    AVX2_WALK(s, pos, ~digit_mask_avx2(x), scan_is_digit);
+}
+
+#undef AVX2_WALK
+
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t skip_space_avx2(const char* s, size_t pos, int* lines, size_t* line_start) {
+    for (int i = 0; i < SCALAR_PROLOGUE; i++, pos++) {
+        char c = s[pos];
+        if (c == '\n') {
+            (*lines)++;
+            *line_start = pos + 1;
+        } else if (c != ' ' && c != '\t') {
+            return pos;
+        }
+    }
+    const char* p = (const char*)((uintptr_t)(s + pos) & ~(uintptr_t)31);
+    uint32_t valid = 0xFFFFFFFFu << (s + pos - p);
+    for (;;) {
+        __m256i x = _mm256_load_si256((const __m256i*)p);
+        __m256i nl = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'));
+        __m256i ws = _mm256_or_si256(nl, _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                                                         _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))));
+        uint32_t nl_mask = (uint32_t)_mm256_movemask_epi8(nl) & valid;
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(ws) & valid;
+        unsigned end = stop ? (unsigned)__builtin_ctz(stop) : 32;
+        count_newlines(nl_mask, end, (size_t)(p - s), lines, line_start);
+        if (stop) return (size_t)(p - s) + end;
+        p += 32;
+        valid = 0xFFFFFFFFu;
+    }
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t skip_quoted_avx2(const char* s, size_t pos, char quote, int* lines, size_t* line_start) {
+    for (int i = 0; i < SCALAR_PROLOGUE; i++, pos++) {
+        char c = s[pos];
+        if (c == quote || c == '\0') return pos;
+        if (c == '\n') {
+            (*lines)++;
+            *line_start = pos + 1;
+        }
+    }
+    const char* p = (const char*)((uintptr_t)(s + pos) & ~(uintptr_t)31);
+    uint32_t valid = 0xFFFFFFFFu << (s + pos - p);
+    for (;;) {
+        __m256i x = _mm256_load_si256((const __m256i*)p);
+        __m256i end_bytes = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(quote)),
+                                            _mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+        uint32_t nl_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'))) & valid;
+        uint32_t stop = (uint32_t)_mm256_movemask_epi8(end_bytes) & valid;
+        unsigned end = stop ? (unsigned)__builtin_ctz(stop) : 32;
+        count_newlines(nl_mask, end, (size_t)(p - s), lines, line_start);
+        if (stop) return (size_t)(p - s) + end;
+        p += 32;
+        valid = 0xFFFFFFFFu;
+    }
+}
+
+static const ScanOps avx2_ops = {
+    "avx2", skip_space_avx2, skip_ident_avx2, skip_digits_avx2, skip_quoted_avx2
+};
+
+const ScanOps* scan_ops_sse2(void) {
+    return __builtin_cpu_supports("sse2") ? &sse2_ops : NULL;
+}
+
+const ScanOps* scan_ops_avx2(void) {
+    return __builtin_cpu_supports("avx2") ? &avx2_ops : NULL;
+}
+
+#else /* !SCAN_X86 */
+
+const ScanOps* scan_ops_sse2(void) {
+    return NULL;
+}
+
+const ScanOps* scan_ops_avx2(void) {
+    return NULL;
+}
+
+#endif /* SCAN_X86 */
+
+const ScanOps* scan_ops_best(void) {
+    const ScanOps* ops = scan_ops_avx2();
+    if (!ops) ops = scan_ops_sse2();
+    return ops ? ops : scan_ops_scalar();
+}
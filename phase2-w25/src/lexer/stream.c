@@ -0,0 +1,124 @@
+/* stream.c */
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../include/lexer.h"
+
+#define STREAM_MIN_CHUNK 4096
+
+// Drop the window bytes before `keep`, then read until at least one chunk
+// of unread input follows it (or the input ends). `keep` is where the next
+// token starts, so the atoms of the tokens before it are dropped too, and
+// lines are counted again from the window's first.
+static void refill(StreamLexer* stream, size_t keep) {
+    Lexer* lexer = &stream->lexer;
+
+    intern_reset(lexer->atoms);
+    stream->line_base += lexer->line - 1;
+    lexer->line = 1;
+
+    memmove(stream->window, stream->window + keep, stream->length - keep);
+    stream->length -= keep;
+    stream->base += keep;
+    lexer->pos -= keep;
+    // May wrap when the current line began before `keep`; columns are
+    // differences of offsets, so the unsigned arithmetic stays correct
+    lexer->line_start -= keep;
+
+    size_t wanted = stream->length + stream->chunk_size;
+    if (wanted > stream->capacity) {
+        // Offsets and line numbers within the window have to fit a Token
+        char* grown = wanted < INT_MAX ? realloc(stream->window, wanted + 1) : NULL;
+        if (!grown) {
+            stream->failed = 1;
+            stream->eof = 1;
+            stream->window[stream->length] = '\0';
+            return;
+        }
+        stream->window = grown;
+        stream->capacity = wanted;
+        lexer->source = grown;
+    }
+
+    while (stream->length < wanted) {
+        ssize_t n = read(stream->fd, stream->window + stream->length, wanted - stream->length);
+        if (n == 0) {
+            stream->eof = 1;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            stream->failed = 1;
+            stream->eof = 1;
+            break;
+        }
+        stream->length += (size_t)n;
+    }
+    stream->window[stream->length] = '\0';
+}
+
+int stream_lexer_init(StreamLexer* stream, int fd, size_t chunk_size, InternTable* atoms) {
+    if (chunk_size < STREAM_MIN_CHUNK) chunk_size = STREAM_MIN_CHUNK;
+    stream->fd = fd;
+    stream->window = malloc(chunk_size + 1);
+    if (!stream->window) return 0;
+    stream->window[0] = '\0';
+    stream->length = 0;
+    stream->capacity = chunk_size;
+    stream->chunk_size = chunk_size;
+    stream->base = 0;
+    stream->line_base = 0;
+    stream->eof = 0;
+    stream->failed = 0;
+    lexer_init(&stream->lexer, stream->window, atoms);
+    return 1;
+}
+
+Token stream_lexer_next(StreamLexer* stream, uint64_t* offset, uint64_t* line) {
+    Lexer* lexer = &stream->lexer;
+    int quiet = lexer->quiet;
+    size_t start;
+    Token token;
+
+    // Keep at least half a chunk ahead so tokens rarely reach the window end
+    if (!stream->eof && stream->length - lexer->pos < stream->chunk_size / 2) {
+        refill(stream, lexer->pos);
+    }
+
+    for (;;) {
+        lexer->pos = lexer->scan->skip_space(lexer->source, lexer->pos, &lexer->line, &lexer->line_start);
+        // Whitespace that reaches the end of the window is done with; keeping
+        // it for the retry would grow the window over a long run of blanks
+        if (!stream->eof && lexer->pos >= stream->length) {
+            refill(stream, lexer->pos);
+            continue;
+        }
+        Lexer saved = *lexer;
+        start = lexer->pos;
+        // Warnings wait until the attempt is kept
+        lexer->quiet = 1;
+        token = lexer_next(lexer);
+        lexer->quiet = quiet;
+        // A token that runs into the end of the window may continue in the
+        // next chunk: rewind, pull in more input and lex it again. The refill
+        // also drops whatever the truncated attempt interned.
+        if (stream->eof || lexer->pos < stream->length) break;
+        *lexer = saved;
+        refill(stream, lexer->pos);
+    }
+    if (!quiet && lexer_warned_char_length(lexer->source, start, token)) {
+        print_char_length_warning(lexer->out, lexer->source[token.offset]);
+    }
+
+    if (offset) *offset = stream->base + token.offset;
+    if (line) *line = stream->line_base + token.line;
+    return token;
+}
+
+void stream_lexer_free(StreamLexer* stream) {
+    free(stream->window);
+    stream->window = NULL;
+}
@@ -0,0 +1,94 @@
+/* token_buffer.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/lexer.h"
+
+#define TOKEN_BUFFER_INITIAL 1024
+// Typical source averages well over this many bytes per token, so sizing
+// the buffer from the input length avoids repeated regrowth
+#define BYTES_PER_TOKEN_ESTIMATE 6
+
+void token_buffer_init(TokenBuffer* buffer) {
+    buffer->types = NULL;
+    buffer->errors = NULL;
+    buffer->offsets = NULL;
+    buffer->lengths = NULL;
+    buffer->lines = NULL;
+    buffer->atoms = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+}
+
+// Grow every column to `capacity` entries
+int token_buffer_reserve(TokenBuffer* buffer, uint32_t capacity) {
+    if (capacity <= buffer->capacity) return 1;
+    uint8_t* types = realloc(buffer->types, capacity * sizeof(*types));
+    if (!types) return 0;
+    buffer->types = types;
+    uint8_t* errors = realloc(buffer->errors, capacity * sizeof(*errors));
+    if (!errors) return 0;
+    buffer->errors = errors;
+    uint32_t* offsets = realloc(buffer->offsets, capacity * sizeof(*offsets));
+    if (!offsets) return 0;
+    buffer->offsets = offsets;
+    uint32_t* lengths = realloc(buffer->lengths, capacity * sizeof(*lengths));
+    if (!lengths) return 0;
+    buffer->lengths = lengths;
+    int* lines = realloc(buffer->lines, capacity * sizeof(*lines));
+    if (!lines) return 0;
+    buffer->lines = lines;
+    Atom* atoms = realloc(buffer->atoms, capacity * sizeof(*atoms));
+    if (!atoms) return 0;
+    buffer->atoms = atoms;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+int lex_all(Lexer* lexer, TokenBuffer* buffer) {
+    Token token;
+    size_t remaining = strlen(lexer->source + lexer->pos);
+    // The EOF token's offset is the size of the input
+    if (lexer->pos + remaining >= UINT32_MAX) return 0;
+    size_t estimate = buffer->count + remaining / BYTES_PER_TOKEN_ESTIMATE + 1;
+    if (estimate > buffer->capacity && !token_buffer_reserve(buffer, (uint32_t)estimate)) {
+        return 0;
+    }
+    do {
+        if (buffer->count == buffer->capacity) {
+            uint32_t capacity = buffer->capacity ? buffer->capacity * 2 : TOKEN_BUFFER_INITIAL;
+            if (!token_buffer_reserve(buffer, capacity)) return 0;
+        }
+        token = lexer_next(lexer);
+        uint32_t i = buffer->count++;
+        buffer->types[i] = token.type;
+        buffer->errors[i] = token.error;
+        buffer->offsets[i] = token.offset;
+        buffer->lengths[i] = token.length;
+        buffer->lines[i] = token.line;
+        buffer->atoms[i] = token.atom;
+    } while (token.type != TOKEN_EOF);
+    return 1;
+}
+
+Token token_buffer_get(const TokenBuffer* buffer, uint32_t index) {
+    Token token;
+    if (index >= buffer->count) index = buffer->count - 1;
+    token.type = buffer->types[index];
+    token.error = buffer->errors[index];
+    token.offset = buffer->offsets[index];
+    token.length = buffer->lengths[index];
+    token.line = buffer->lines[index];
+    token.atom = buffer->atoms[index];
+    return token;
+}
+
+void token_buffer_free(TokenBuffer* buffer) {
+    free(buffer->types);
+    free(buffer->errors);
+    free(buffer->offsets);
+    free(buffer->lengths);
+    free(buffer->lines);
+    free(buffer->atoms);
+    token_buffer_init(buffer);
+}
@@ -0,0 +1,112 @@
+/* ast.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/parser.h"
+
+#define AST_INITIAL_NODES 1024
+// Walks shallower than this need no heap allocation
+#define AST_WALK_LOCAL_DEPTH 64
+
+typedef struct {
+    NodeId node;
+    uint32_t next_child;        // Child to visit next
+} WalkFrame;
+
+void ast_init(Ast* ast) {
+    ast->nodes = NULL;
+    ast->count = 0;
+    ast->capacity = 0;
+    ast->children = NULL;
+    ast->child_total = 0;
+    ast->child_capacity = 0;
+    ast->root = AST_NO_NODE;
+    ast->failed = 0;
+}
+
+void ast_reset(Ast* ast) {
+    ast->count = 0;
+    ast->child_total = 0;
+    ast->root = AST_NO_NODE;
+    ast->failed = 0;
+}
+
+void ast_free(Ast* ast) {
+    free(ast->nodes);
+    free(ast->children);
+    ast_init(ast);
+}
+
+int ast_grow(Ast* ast, uint32_t count) {
+    if (ast->count == ast->capacity) {
+        uint32_t capacity = ast->capacity ? ast->capacity * 2 : AST_INITIAL_NODES;
+        ASTNode* nodes = realloc(ast->nodes, capacity * sizeof(*nodes));
+        if (!nodes) {
+            ast->failed = 1;
+            return 0;
+        }
+        ast->nodes = nodes;
+        ast->capacity = capacity;
+    }
+    if (ast->child_total + count > ast->child_capacity) {
+        uint32_t capacity = ast->child_capacity ? ast->child_capacity : AST_INITIAL_NODES;
+        while (capacity < ast->child_total + count) capacity *= 2;
+        NodeId* grown = realloc(ast->children, capacity * sizeof(*grown));
+        if (!grown) {
+            ast->failed = 1;
+            return 0;
+        }
+        ast->children = grown;
+        ast->child_capacity = capacity;
+    }
+    return 1;
+}
+
+TokenText ast_text(const char* source, const ASTNode* node) {
+    Token token = {node->token_type, node->error, node->offset, node->length, node->line, node->atom};
+    return token_text(source, token);
+}
+
+int ast_walk(const Ast* ast, NodeId root, AstEnter enter, AstLeave leave, void* context) {
+    if (root == AST_NO_NODE) return 1;
+    WalkFrame local[AST_WALK_LOCAL_DEPTH];
+    WalkFrame* stack = local;
+    uint32_t capacity = AST_WALK_LOCAL_DEPTH;
+    uint32_t count = 0;
+
+    stack[count++] = (WalkFrame){root, 0};
+    if (enter && enter(ast, root, 0, context) == AST_WALK_SKIP) {
+        stack[0].next_child = ast->nodes[root].child_count;
+    }
+
+    while (count > 0) {
+        WalkFrame* top = &stack[count - 1];
+        const ASTNode* node = &ast->nodes[top->node];
+        if (top->next_child == node->child_count) {
+            if (leave) leave(ast, top->node, count - 1, context);
+            count--;
+            continue;
+        }
+
+        NodeId child = ast->children[node->first_child + top->next_child++];
+        if (count == capacity) {
+            WalkFrame* grown = stack == local ? malloc(capacity * 2 * sizeof(*grown))
+                                              : realloc(stack, capacity * 2 * sizeof(*grown));
+            if (!grown) {
+                if (stack != local) free(stack);
+                return 0;
+            }
+            if (stack == local) memcpy(grown, local, sizeof(local));
+            stack = grown;
+            capacity *= 2;
+        }
+        stack[count] = (WalkFrame){child, 0};
+        if (enter && enter(ast, child, count, context) == AST_WALK_SKIP) {
+            stack[count].next_child = ast->nodes[child].child_count;
+        }
+        count++;
+    }
+
+    if (stack != local) free(stack);
+    return 1;
+}
@@ -1,4 +1,5 @@
 /* parser.c */
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,584 +7,1148 @@
 #include "../../include/lexer.h"
 #include "../../include/tokens.h"
 
-// Current token being processed
-static Token current_token;
-static int position = 0;
-static const char *source;
-static void advance(void);
+// Open blocks and parentheses nest at most this deep; anything deeper is
+// reported and skipped rather than parsed
+#ifndef PARSER_MAX_DEPTH
+#define PARSER_MAX_DEPTH 100000
+#endif
+
+// Statements are parsed without recursion: each block still being parsed,
+// and each if/while/repeat waiting for its block, is a frame on a stack.
+// Their children collect on the pending stack above `mark`.
+typedef struct {
+    ASTNodeType type;           // AST_PROGRAM, AST_BLOCK, AST_IF, AST_WHILE or AST_REPEAT
+    Token token;
+    uint32_t mark;
+} Frame;
+
+// Operators and open parentheses of the expression being parsed
+typedef struct {
+    Token token;
+    uint8_t precedence;         // 0 for an open parenthesis
+} PendingOperator;
+
+// The lexer's invalid-number error, reported by the parser
+#define LEXICAL_INVALID_NUMBER 0xff
+
+// An error of the current parse; the messages are rendered once it ends,
+// after an incremental reparse has moved the tokens into place
+typedef struct {
+    uint8_t error;              // ParseError, or LEXICAL_INVALID_NUMBER
+    Token token;
+} Diagnostic;
+
+// A top-level statement of the tree. Statements are independent of each
+// other, so an edit only needs the statements around it parsed again.
+typedef struct {
+    uint32_t start;             // End of the token before it, where lexing its first token begins
+    int line;                   // Line at `start`
+    uint8_t lexer_state;        // Effective type of the token before it
+    NodeId first_node;          // Its subtree is the nodes from here to the next statement's
+    uint32_t first_edge;        // Likewise for the child edges ...
+    uint32_t first_diagnostic;  // ... and the diagnostics
+} Statement;
+
+// Stands in for the token before the first: lexing starts at offset 0 of
+// line 1, in the state lexer_init leaves the lexer in
+static const Token start_of_input = {TOKEN_EOF, ERROR_NONE, 0, 0, 1, ATOM_NONE};
+
+// Everything one parse touches lives here, so independent parsers can run
+// on different threads at once
+struct Parser {
+    // Current token being processed, and the one before it
+    Token current_token;
+    Token previous_token;
+    const char *source;
+    // On-demand mode pulls tokens from the lexer; batch mode walks a
+    // pre-lexed TokenBuffer by index
+    Lexer lexer;
+    const TokenBuffer *tokens;
+    uint32_t token_index;
+    // Tree being built
+    Ast ast;
+    Statement *statements;
+    uint32_t statement_count;
+    uint32_t statement_capacity;
+
+    // Children of the nodes still being parsed; a node's children are the
+    // entries pushed since its parse function (or frame) started
+    NodeId *pending;
+    uint32_t pending_count;
+    uint32_t pending_capacity;
+    Frame *frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+    PendingOperator *operators;
+    uint32_t operator_count;
+    uint32_t operator_capacity;
+    // Blocks and parentheses currently open
+    uint32_t depth;
+
+    Diagnostic *diagnostics;
+    uint32_t diagnostic_count;
+    uint32_t diagnostic_capacity;
+    // Messages of the last parse, NUL-terminated
+    char *messages;
+    size_t messages_length;
+    size_t messages_capacity;
+};
+
+// Append a formatted message to the parse's messages. A message that
+// does not fit in memory is dropped.
+static void report(Parser *parser, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) return;
+
+    size_t needed = parser->messages_length + length + 1;
+    if (needed > parser->messages_capacity) {
+        size_t capacity = parser->messages_capacity ? parser->messages_capacity : 256;
+        while (capacity < needed) capacity *= 2;
+        char *grown = realloc(parser->messages, capacity);
+        if (!grown) return;
+        parser->messages = grown;
+        parser->messages_capacity = capacity;
+    }
+    va_start(args, format);
+    vsnprintf(parser->messages + parser->messages_length, length + 1, format, args);
+    va_end(args);
+    parser->messages_length += length;
+}
+
+static void advance(Parser *parser);
 
-static void synchronize(void) {
-    while (current_token.type != TOKEN_EOF &&
-           current_token.type != TOKEN_SEMICOLON &&
-           current_token.type != TOKEN_RBRACE) {
-        advance();
+static void synchronize(Parser *parser) {
+    while (parser->current_token.type != TOKEN_EOF &&
+           parser->current_token.type != TOKEN_SEMICOLON &&
+           parser->current_token.type != TOKEN_RBRACE) {
+        advance(parser);
     }
-    if (current_token.type == TOKEN_SEMICOLON || current_token.type == TOKEN_RBRACE) {
-        advance();
+    if (parser->current_token.type == TOKEN_SEMICOLON || parser->current_token.type == TOKEN_RBRACE) {
+        advance(parser);
     }
 }
 
-static void parse_error(ParseError error, Token token) {
-    printf("Parse Error at line %d: ", token.line);
-    switch (error) {
+static void render_diagnostic(Parser *parser, const Diagnostic *diagnostic) {
+    Token token = diagnostic->token;
+    TokenText lexeme = token_text(parser->source, token);
+    if (diagnostic->error == LEXICAL_INVALID_NUMBER) {
+        // Worded as the lexer's print_error does
+        report(parser, "Lexical Error at line %d: Invalid number format\n", token.line);
+        return;
+    }
+    report(parser, "Parse Error at line %d: ", token.line);
+    switch (diagnostic->error) {
         case PARSE_ERROR_UNEXPECTED_TOKEN:
-            printf("Unexpected token '%s'\n", token.lexeme);
+            report(parser, "Unexpected token '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case PARSE_ERROR_MISSING_SEMICOLON:
-            printf("Missing semicolon after '%s'\n", token.lexeme);
+            report(parser, "Missing semicolon after '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case PARSE_ERROR_MISSING_IDENTIFIER:
-            printf("Expected identifier after '%s'\n", token.lexeme);
+            report(parser, "Expected identifier after '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case PARSE_ERROR_MISSING_EQUALS:
-            printf("Expected '=' after '%s'\n", token.lexeme);
+            report(parser, "Expected '=' after '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case PARSE_ERROR_INVALID_EXPRESSION:
-            printf("Invalid expression after '%s'\n", token.lexeme);
+            report(parser, "Invalid expression after '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case PARSE_ERROR_MISSING_RPAREN:
-            printf("Expected right parentheses after '%s'\n", token.lexeme);
+            report(parser, "Expected right parentheses after '%.*s'\n", lexeme.length, lexeme.text);
             break;
         case PARSE_ERROR_MISSING_UNTIL:
-            printf("Expected 'Until', found '%s' instead.\n", token.lexeme);
+            report(parser, "Expected 'Until', found '%.*s' instead.\n", lexeme.length, lexeme.text);
+            break;
+        case PARSE_ERROR_TOO_DEEP:
+            report(parser, "Nesting deeper than %d levels at '%.*s'\n", PARSER_MAX_DEPTH, lexeme.length, lexeme.text);
             break;
         // Additional error types (e.g. missing block bracket) can be added here.
         default:
-            printf("Unknown error\n");
+            report(parser, "Unknown error\n");
     }
 }
 
-// Get next token
-static void advance(void) {
-    current_token = get_next_token(source, &position);
+// Render every diagnostic of the finished parse into its messages
+static void render_diagnostics(Parser *parser) {
+    parser->messages_length = 0;
+    if (parser->messages) parser->messages[0] = '\0';
+    for (uint32_t i = 0; i < parser->diagnostic_count; i++) {
+        render_diagnostic(parser, &parser->diagnostics[i]);
+    }
 }
 
-// Create a new AST node
-static ASTNode *create_node(ASTNodeType type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (node) {
-        node->type = type;
-        node->token = current_token;
-        node->left = NULL;
-        node->right = NULL;
+// Make room for one more item on a stack; returns the (possibly moved)
+// items, or NULL with ast->failed set
+static void *reserve(Parser *parser, void *items, uint32_t count, uint32_t *capacity, size_t size) {
+    if (count < *capacity) return items;
+    uint32_t grown_capacity = *capacity ? *capacity * 2 : 64;
+    void *grown = realloc(items, grown_capacity * size);
+    if (!grown) {
+        parser->ast.failed = 1;
+        return NULL;
     }
+    *capacity = grown_capacity;
+    return grown;
+}
+
+static void parse_error(Parser *parser, uint8_t error, Token token) {
+    Diagnostic *grown = reserve(parser, parser->diagnostics, parser->diagnostic_count, &parser->diagnostic_capacity, sizeof(*parser->diagnostics));
+    if (!grown) return;
+    parser->diagnostics = grown;
+    parser->diagnostics[parser->diagnostic_count].error = error;
+    parser->diagnostics[parser->diagnostic_count].token = token;
+    parser->diagnostic_count++;
+}
+
+// Get next token
+static void advance(Parser *parser) {
+    parser->previous_token = parser->current_token;
+    if (parser->tokens) {
+        parser->current_token = token_buffer_get(parser->tokens, parser->token_index++);
+    } else {
+        parser->current_token = lexer_next(&parser->lexer);
+    }
+}
+
+
+// The state the lexer produced the current token in: the effective type
+// of the token before it
+static uint8_t lexer_state(const Parser *parser) {
+    Token previous = parser->previous_token;
+    return previous.error == ERROR_CONSECUTIVE_OPERATORS ? TOKEN_OPERATOR : previous.type;
+}
+
+static void push_child(Parser *parser, NodeId child) {
+    NodeId *grown = reserve(parser, parser->pending, parser->pending_count, &parser->pending_capacity, sizeof(*parser->pending));
+    if (!grown) return;
+    parser->pending = grown;
+    parser->pending[parser->pending_count++] = child;
+}
+
+// Create a node for `token` whose children are everything pushed since `mark`
+static NodeId finish_node(Parser *parser, ASTNodeType type, Token token, uint32_t mark) {
+    NodeId node = ast_add(&parser->ast, type, token, parser->pending + mark, parser->pending_count - mark);
+    parser->pending_count = mark;
     return node;
 }
 
+// Create a childless node for the current token
+static NodeId leaf_node(Parser *parser, ASTNodeType type) {
+    return finish_node(parser, type, parser->current_token, parser->pending_count);
+}
+
 // Match current token with expected type
-static int match(TokenType type) {
-    return current_token.type == type;
+static int match(Parser *parser, TokenType type) {
+    return parser->current_token.type == type;
 }
 
 // Expect a token type or recover
-static void expect(TokenType type, ParseError error) {
-    if (match(type)) {
-        advance();
+static void expect(Parser *parser, TokenType type, ParseError error) {
+    if (match(parser, type)) {
+        advance(parser);
     } else {
-        parse_error(error, current_token);
-        synchronize();
+        parse_error(parser, error, parser->current_token);
+        synchronize(parser);
     }
 }
 
-static void expect_default(TokenType type) {
-    expect(type, PARSE_ERROR_UNEXPECTED_TOKEN);
+static void expect_default(Parser *parser, TokenType type) {
+    expect(parser, type, PARSE_ERROR_UNEXPECTED_TOKEN);
 }
 
 // Forward declarations
-static ASTNode *parse_statement(void);
-static ASTNode *parse_primary(void);
-static ASTNode *parse_expression(void);
-static ASTNode *parse_block(void);
-static ASTNode *parse_while(void);
-static ASTNode *parse_if(void);
-static ASTNode *parse_print(void);
-static ASTNode *parse_repeat(void);
-static ASTNode *parse_factorial(void);
+static NodeId parse_expression(Parser *parser);
+
+
+static int push_frame(Parser *parser, ASTNodeType type, Token token) {
+    Frame *grown = reserve(parser, parser->frames, parser->frame_count, &parser->frame_capacity, sizeof(*parser->frames));
+    if (!grown) return 0;
+    parser->frames = grown;
+    parser->frames[parser->frame_count].type = type;
+    parser->frames[parser->frame_count].token = token;
+    parser->frames[parser->frame_count].mark = parser->pending_count;
+    parser->frame_count++;
+    return 1;
+}
 
-// Parse variable declaration: int x;
-static ASTNode *parse_declaration(void) {
-    ASTNode *node = create_node(AST_VARDECL);
-    node->token = current_token;
-    advance(); // consume variable name
+// Skip a balanced open ... close region starting at the current token,
+// stopping early at the end of input or before a `stop` token
+static void skip_nested(Parser *parser, TokenType open, TokenType close, TokenType stop) {
+    uint32_t level = 0;
+    do {
+        if (match(parser, open)) level++;
+        else if (match(parser, close)) level--;
+        advance(parser);
+    } while (level > 0 && !match(parser, TOKEN_EOF) && !match(parser, stop));
+}
 
-    if (!match(TOKEN_IDENTIFIER)) {
-        parse_error(PARSE_ERROR_MISSING_IDENTIFIER, current_token);
-        synchronize();
-        return node;
+// Parse variable declaration: int x;
+static NodeId parse_declaration(Parser *parser) {
+    Token type_token = parser->current_token;
+    uint32_t mark = parser->pending_count;
+    advance(parser); // consume variable name
+
+    if (!match(parser, TOKEN_IDENTIFIER)) {
+        parse_error(parser, PARSE_ERROR_MISSING_IDENTIFIER, parser->current_token);
+        synchronize(parser);
+        return finish_node(parser, AST_VARDECL, type_token, mark);
     }
 
     // Create a new node for the identifier
-    ASTNode *identifier_node = create_node(AST_IDENTIFIER);
-    identifier_node->token = current_token;
-    node->left = identifier_node;
-    advance();
+    push_child(parser, leaf_node(parser, AST_IDENTIFIER));
+    advance(parser);
 
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        synchronize();
-        return node;
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON, parser->current_token);
+        synchronize(parser);
+        return finish_node(parser, AST_VARDECL, type_token, mark);
     }
-    advance();
-    return node;
+    advance(parser);
+    return finish_node(parser, AST_VARDECL, type_token, mark);
 }
 
 // Parse assignment: x = 5;
-static ASTNode *parse_assignment(void) {
-    ASTNode *node = create_node(AST_ASSIGN);
-    node->left = create_node(AST_IDENTIFIER);
-    node->left->token = current_token;
-    advance();
-
-    if (!match(TOKEN_EQUALS)) {
-        parse_error(PARSE_ERROR_MISSING_EQUALS, current_token);
-        synchronize();
-        return node;
+static NodeId parse_assignment(Parser *parser) {
+    Token name = parser->current_token;
+    uint32_t mark = parser->pending_count;
+    push_child(parser, leaf_node(parser, AST_IDENTIFIER));
+    advance(parser);
+
+    if (!match(parser, TOKEN_EQUALS)) {
+        parse_error(parser, PARSE_ERROR_MISSING_EQUALS, parser->current_token);
+        synchronize(parser);
+        return finish_node(parser, AST_ASSIGN, name, mark);
     }
-    advance();
+    advance(parser);
 
-    node->right = parse_expression();
+    push_child(parser, parse_expression(parser));
 
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        synchronize();
-        return node;
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON, parser->current_token);
+        synchronize(parser);
+        return finish_node(parser, AST_ASSIGN, name, mark);
     }
-    advance();
-    return node;
+    advance(parser);
+    return finish_node(parser, AST_ASSIGN, name, mark);
 }
 
-static ASTNode *parse_block(void) {
-    ASTNode *node = create_node(AST_BLOCK);
-    if (!match(TOKEN_LBRACE)) {
-        parse_error(PARSE_ERROR_UNEXPECTED_TOKEN, current_token);
-        synchronize();
-        return node;
-    }
-    advance();  // consume '{'
+// The innermost if/while/repeat frame has its block: finish the statement
+// and add it to the enclosing block
+static void finish_compound(Parser *parser, NodeId block) {
+    push_child(parser, block);
+    Frame frame = parser->frames[--parser->frame_count];
+
+    if (frame.type == AST_REPEAT) {
+        if (!match(parser, TOKEN_UNTIL)) {
+            parse_error(parser, PARSE_ERROR_MISSING_UNTIL, parser->current_token);
+            synchronize(parser);
+            push_child(parser, finish_node(parser, AST_REPEAT, frame.token, frame.mark));
+            return;
+        }
+        advance(parser);
 
-    ASTNode *first = NULL;  
-    ASTNode *tail = NULL;   // keep track of the chain tail
+        push_child(parser, parse_expression(parser));
 
-    while (!match(TOKEN_RBRACE) && !match(TOKEN_EOF)) {
-        ASTNode *stmt = parse_statement();
-        if (!first) {
-            first = stmt;
-            tail = stmt;
-        } else {
-            // Instead of directly assigning tail->right, traverse to the end of the sibling chain.
-            tail->right = stmt;
-            // Now update tail to be the last node in stmt’s chain (if stmt itself has a chain).
-            while (tail->right) {
-                tail = tail->right;
-            }
+        if (!match(parser, TOKEN_SEMICOLON)) {
+            parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON, parser->current_token);
+            synchronize(parser);
+            push_child(parser, finish_node(parser, AST_REPEAT, frame.token, frame.mark));
+            return;
         }
+        advance(parser);
     }
+    push_child(parser, finish_node(parser, frame.type, frame.token, frame.mark));
+}
 
-    node->left = first;  // attach the chain of statements to the block node
-
-    if (!match(TOKEN_RBRACE)) {
-        parse_error(PARSE_ERROR_MISSING_BRACKET, current_token);
-        synchronize();
-    } else {
-        ASTNode *block_end = create_node(AST_BLOCK_END);
-        if (tail) {
-            tail->right = block_end;
-        } else {
-            node->left = block_end;
-        }
-        advance();  // consume '}'
+// Open the block of the innermost if/while/repeat frame
+static void open_block(Parser *parser) {
+    Token brace = parser->current_token;
+    if (!match(parser, TOKEN_LBRACE)) {
+        parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN, parser->current_token);
+        synchronize(parser);
+        finish_compound(parser, finish_node(parser, AST_BLOCK, brace, parser->pending_count));
+        return;
     }
-    return node;
+    if (parser->depth >= PARSER_MAX_DEPTH) {
+        parse_error(parser, PARSE_ERROR_TOO_DEEP, parser->current_token);
+        skip_nested(parser, TOKEN_LBRACE, TOKEN_RBRACE, TOKEN_EOF);
+        finish_compound(parser, finish_node(parser, AST_BLOCK, brace, parser->pending_count));
+        return;
+    }
+    advance(parser);  // consume '{'
+    if (push_frame(parser, AST_BLOCK, brace)) parser->depth++;
 }
 
+// The current token is '}' or the end of input: close the innermost block
+static void close_block(Parser *parser) {
+    Frame frame = parser->frames[--parser->frame_count];
+    parser->depth--;
 
-// Parse: if (condition) { ... }
-static ASTNode *parse_if(void) {
-    ASTNode *node = create_node(AST_IF);
-    advance();
-    
-    if (!match(TOKEN_LPAREN)) {
-        parse_error(PARSE_ERROR_UNEXPECTED_TOKEN, current_token);
-        synchronize();
-    } else {
-        advance(); // consume '('
-    }
-    
-    node->left = parse_expression();
-    
-    if (!match(TOKEN_RPAREN)) {
-        parse_error(PARSE_ERROR_MISSING_RPAREN, current_token);
-        synchronize();
+    if (!match(parser, TOKEN_RBRACE)) {
+        parse_error(parser, PARSE_ERROR_MISSING_BRACKET, parser->current_token);
+        synchronize(parser);
     } else {
-        advance(); // consume ')'
+        advance(parser);  // consume '}'
     }
-    
-    node->right = parse_block();
-    return node;
+    finish_compound(parser, finish_node(parser, AST_BLOCK, frame.token, frame.mark));
 }
 
-static ASTNode *parse_while(void) {
-    ASTNode *node = create_node(AST_WHILE);
-    advance();
+// Parse: if (condition) { ... } and while (condition) { ... } up to the block
+static void parse_conditional(Parser *parser, ASTNodeType type) {
+    if (!push_frame(parser, type, parser->current_token)) return;
+    advance(parser);
     
-    if (!match(TOKEN_LPAREN)) {
-        parse_error(PARSE_ERROR_UNEXPECTED_TOKEN, current_token);
-        synchronize();
+    if (!match(parser, TOKEN_LPAREN)) {
+        parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN, parser->current_token);
+        synchronize(parser);
     } else {
-        advance(); // consume '('
+        advance(parser); // consume '('
     }
     
-    node->left = parse_expression();
+    push_child(parser, parse_expression(parser));
     
-    if (!match(TOKEN_RPAREN)) {
-        parse_error(PARSE_ERROR_MISSING_RPAREN, current_token);
-        synchronize();
+    if (!match(parser, TOKEN_RPAREN)) {
+        parse_error(parser, PARSE_ERROR_MISSING_RPAREN, parser->current_token);
+        synchronize(parser);
     } else {
-        advance(); // consume ')'
+        advance(parser); // consume ')'
     }
     
-    node->right = parse_block();
-    return node;
+    open_block(parser);
+}
+
+// Parse: repeat { ... } until (condition); the until clause follows the block
+static void parse_repeat(Parser *parser) {
+    if (!push_frame(parser, AST_REPEAT, parser->current_token)) return;
+    advance(parser);
+    open_block(parser);
 }
 
-static ASTNode *parse_print(void) {
-    ASTNode *node = create_node(AST_PRINT);
-    advance(); // consume 'print'
+static NodeId parse_print(Parser *parser) {
+    Token keyword = parser->current_token;
+    uint32_t mark = parser->pending_count;
+    advance(parser); // consume 'print'
     
-    node->left = parse_expression();
+    push_child(parser, parse_expression(parser));
     
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        synchronize();
-        return node;
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON, parser->current_token);
+        synchronize(parser);
+        return finish_node(parser, AST_PRINT, keyword, mark);
     }
-    advance(); // consume ';'
-    return node;
+    advance(parser); // consume ';'
+    return finish_node(parser, AST_PRINT, keyword, mark);
 }
 
-static ASTNode *parse_repeat(void) {
-    ASTNode *node = create_node(AST_REPEAT);
-    advance();
-    
-    node->left = parse_block();
-    
-    if (!match(TOKEN_UNTIL)) {
-        parse_error(PARSE_ERROR_MISSING_UNTIL, current_token);
-        synchronize();
-        return node;
+static NodeId parse_factorial(Parser *parser) {
+    Token keyword = parser->current_token;
+    uint32_t mark = parser->pending_count;
+    advance(parser);
+    push_child(parser, parse_expression(parser));
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON, parser->current_token);
+        synchronize(parser);
+        return finish_node(parser, AST_FACTORIAL, keyword, mark);
     }
-    advance();
-    
-    node->right = parse_expression();
-    
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        synchronize();
-        return node;
+    advance(parser);
+    return finish_node(parser, AST_FACTORIAL, keyword, mark);
+}
+
+// Parse statement; compound statements open a frame instead of returning
+static void parse_statement(Parser *parser) {
+    if (match(parser, TOKEN_INT) 
+    || match(parser, TOKEN_FLOAT) 
+    || match(parser, TOKEN_BOOL)
+    || match(parser, TOKEN_CHAR)
+    || match(parser, TOKEN_STRING)) {
+        push_child(parser, parse_declaration(parser));
+    } else if (match(parser, TOKEN_IDENTIFIER)) {
+        push_child(parser, parse_assignment(parser));
+    } else if (match(parser, TOKEN_IF)) {
+        parse_conditional(parser, AST_IF);
+    } else if (match(parser, TOKEN_WHILE)) {
+        parse_conditional(parser, AST_WHILE);
+    } else if (match(parser, TOKEN_PRINT)) {
+        push_child(parser, parse_print(parser));
+    } else if (match(parser, TOKEN_REPEAT)) {
+        parse_repeat(parser);
+    } else if (match(parser, TOKEN_FACTORIAL)) {
+        push_child(parser, parse_factorial(parser));
+    } else {
+        parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN, parser->current_token);
+        synchronize(parser);
+        push_child(parser, leaf_node(parser, AST_ERROR));
     }
-    advance();
-    return node;
 }
 
-static ASTNode *parse_factorial(void) {
-    ASTNode *node = create_node(AST_FACTORIAL);
-    advance();
-    node->right = parse_expression();
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        synchronize();
-        return node;
+// Binary operators, indexed by operator atom - ATOM_FIRST_OPERATOR. A
+// higher precedence binds tighter; all operators are left-associative.
+// Adding an operator is a new atom plus an entry here.
+static const struct {
+    uint8_t precedence;
+    uint8_t node_type;          // ASTNodeType of the resulting node
+} binary_operators[ATOM_LAST_OPERATOR - ATOM_FIRST_OPERATOR + 1] = {
+    [ATOM_PLUS - ATOM_FIRST_OPERATOR]  = {2, AST_BINOP},
+    [ATOM_MINUS - ATOM_FIRST_OPERATOR] = {2, AST_BINOP},
+    [ATOM_STAR - ATOM_FIRST_OPERATOR]  = {3, AST_BINOP},
+    [ATOM_SLASH - ATOM_FIRST_OPERATOR] = {3, AST_BINOP},
+    [ATOM_LT - ATOM_FIRST_OPERATOR]    = {1, AST_COMPOP},
+    [ATOM_GT - ATOM_FIRST_OPERATOR]    = {1, AST_COMPOP},
+    [ATOM_EQ - ATOM_FIRST_OPERATOR]    = {1, AST_COMPOP},
+    [ATOM_NE - ATOM_FIRST_OPERATOR]    = {1, AST_COMPOP},
+};
+
+// Precedence of the current token as a binary operator, 0 if it is not one
+static int operator_precedence(Parser *parser) {
+    if (!match(parser, TOKEN_OPERATOR) && !match(parser, TOKEN_COMPARISON)) return 0;
+    return binary_operators[parser->current_token.atom - ATOM_FIRST_OPERATOR].precedence;
+}
+
+// Replace the top two operands with the top operator applied to them
+static void reduce(Parser *parser) {
+    Token operator_token = parser->operators[--parser->operator_count].token;
+    NodeId *operands = &parser->pending[parser->pending_count - 2];
+    // The node takes the place of its two operands
+    operands[0] = ast_add(&parser->ast, binary_operators[operator_token.atom - ATOM_FIRST_OPERATOR].node_type,
+                          operator_token, operands, 2);
+    parser->pending_count--;
+}
+
+// Parse a literal, identifier or invalid operand
+static NodeId parse_primary(Parser *parser) {
+    NodeId node;
+
+    if (match(parser, TOKEN_NUMBER)) {
+        node = leaf_node(parser, AST_NUMBER);
+        advance(parser);
+    } else if (match(parser, TOKEN_IDENTIFIER)) {
+        node = leaf_node(parser, AST_IDENTIFIER);
+        advance(parser);
+    } else if (match(parser, TOKEN_STRING)) {  // Handle string literals
+        node = leaf_node(parser, AST_STRING);
+        advance(parser);
+    } else if (match(parser, TOKEN_CHAR)) {  // Handle string literals
+        node = leaf_node(parser, AST_CHAR);
+        advance(parser);
+    } else if (parser->current_token.error == ERROR_INVALID_NUMBER) {
+        // Out-of-range or malformed literal: report the lexer's diagnostic
+        parse_error(parser, LEXICAL_INVALID_NUMBER, parser->current_token);
+        node = leaf_node(parser, AST_ERROR);
+        advance(parser);
+    } else {
+        parse_error(parser, PARSE_ERROR_INVALID_EXPRESSION, parser->current_token);
+        synchronize(parser);
+        return leaf_node(parser, AST_ERROR);
     }
-    advance();
     return node;
 }
 
-// Parse statement
-static ASTNode *parse_statement(void) {
-    if (match(TOKEN_INT) 
-    || match(TOKEN_FLOAT) 
-    || match(TOKEN_BOOL)
-    || match(TOKEN_CHAR)
-    || match(TOKEN_STRING)) {
-        return parse_declaration();
-    } else if (match(TOKEN_IDENTIFIER)) {
-        return parse_assignment();
-    } else if (match(TOKEN_IF)) {
-        return parse_if();
-    } else if (match(TOKEN_WHILE)) {
-        return parse_while();
-    } else if (match(TOKEN_PRINT)) {
-        return parse_print();
-    } else if (match(TOKEN_REPEAT)) {
-        return parse_repeat();
-    } else if (match(TOKEN_FACTORIAL)) {
-        return parse_factorial();
-    }
-    parse_error(PARSE_ERROR_UNEXPECTED_TOKEN, current_token);
-    synchronize();
-    return create_node(AST_ERROR);
-}
-
-// Parse expression (basic support for numbers, identifiers, and simple operations)
-static ASTNode *parse_multiplication(void) {
-    ASTNode *node = parse_primary();
-
-    while (match(TOKEN_OPERATOR) &&
-          (strcmp(current_token.lexeme, "*") == 0 || strcmp(current_token.lexeme, "/") == 0)) {
-
-        Token operator_token = current_token;
-        advance();
-
-        ASTNode *new_node = create_node(AST_BINOP);
-        new_node->token = operator_token;
-        new_node->left = node;
-        new_node->right = parse_primary();
-        node = new_node;
+// Push a binary operator, or an open parenthesis with precedence 0
+static int push_operator(Parser *parser, Token token, uint8_t precedence) {
+    PendingOperator *grown = reserve(parser, parser->operators, parser->operator_count, &parser->operator_capacity, sizeof(*parser->operators));
+    if (!grown) return 0;
+    parser->operators = grown;
+    parser->operators[parser->operator_count].token = token;
+    parser->operators[parser->operator_count].precedence = precedence;
+    parser->operator_count++;
+    return 1;
+}
+
+// Parse one operand, opening any parentheses in front of it
+static void parse_operand(Parser *parser) {
+    while (match(parser, TOKEN_LPAREN)) {
+        if (parser->depth >= PARSER_MAX_DEPTH) {
+            Token paren = parser->current_token;
+            parse_error(parser, PARSE_ERROR_TOO_DEEP, paren);
+            skip_nested(parser, TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_SEMICOLON);
+            push_child(parser, finish_node(parser, AST_ERROR, paren, parser->pending_count));
+            return;
+        }
+        if (!push_operator(parser, parser->current_token, 0)) return;
+        parser->depth++;
+        advance(parser);
     }
-    return node;
+    push_child(parser, parse_primary(parser));
 }
 
-static ASTNode *parse_addition(void) {
-    ASTNode *node = parse_multiplication();
+// Parse expression (numbers, identifiers, literals, parentheses and binary
+// operations). Operators wait on the operator stack until one that binds
+// no tighter arrives, so nesting costs heap rather than C stack.
+static NodeId parse_expression(Parser *parser) {
+    uint32_t base = parser->operator_count;
+    uint32_t mark = parser->pending_count;
+
+    parse_operand(parser);
+    while (!parser->ast.failed) {
+        int precedence = operator_precedence(parser);
+        if (precedence) {
+            while (parser->operator_count > base && parser->operators[parser->operator_count - 1].precedence >= precedence) {
+                reduce(parser);
+            }
+            if (!push_operator(parser, parser->current_token, precedence)) break;
+            advance(parser);
+            parse_operand(parser);
+            continue;
+        }
+
+        // Not an operator: the innermost parenthesis or the expression ends
+        while (parser->operator_count > base && parser->operators[parser->operator_count - 1].precedence) {
+            reduce(parser);
+        }
+        if (parser->operator_count == base) {
+            return parser->pending[--parser->pending_count];
+        }
+        parser->operator_count--;
+        parser->depth--;
+        expect(parser, TOKEN_RPAREN, PARSE_ERROR_MISSING_RPAREN);
+    }
 
-    while (match(TOKEN_OPERATOR) &&
-          (strcmp(current_token.lexeme, "+") == 0 || strcmp(current_token.lexeme, "-") == 0)) {
+    // Out of memory: drop the partial expression
+    parser->operator_count = base;
+    parser->pending_count = mark;
+    return AST_NO_NODE;
+}
 
-        Token operator_token = current_token;
-        advance();
+// Parse one top-level statement, including every block it opens, and
+// record where it starts
+static void parse_top_level(Parser *parser) {
+    Statement *grown = reserve(parser, parser->statements, parser->statement_count, &parser->statement_capacity, sizeof(*parser->statements));
+    if (!grown) return;
+    parser->statements = grown;
+    Statement *statement = &parser->statements[parser->statement_count++];
+    statement->start = parser->previous_token.offset + parser->previous_token.length;
+    statement->line = parser->previous_token.line;
+    statement->lexer_state = lexer_state(parser);
+    statement->first_node = parser->ast.count;
+    statement->first_edge = parser->ast.child_total;
+    statement->first_diagnostic = parser->diagnostic_count;
+
+    parse_statement(parser);
+    while (parser->frame_count > 1 && !parser->ast.failed) {
+        if (match(parser, TOKEN_RBRACE) || match(parser, TOKEN_EOF)) {
+            close_block(parser);
+        } else {
+            parse_statement(parser);
+        }
+    }
+}
 
-        ASTNode *new_node = create_node(AST_BINOP);
-        new_node->token = operator_token;
-        new_node->left = node;
-        new_node->right = parse_multiplication();
-        node = new_node;
+// Close the program frame: the root takes every pending statement
+static NodeId finish_program(Parser *parser, Token program) {
+    render_diagnostics(parser);
+    if (parser->ast.failed) return AST_NO_NODE;
+    parser->frame_count--;
+    parser->ast.root = finish_node(parser, AST_PROGRAM, program, 0);
+    return parser->ast.failed ? AST_NO_NODE : parser->ast.root;
+}
+
+// Parse program (multiple statements)
+static NodeId parse_program(Parser *parser) {
+    Token program = parser->current_token;
+    push_frame(parser, AST_PROGRAM, program);
+    while (!match(parser, TOKEN_EOF) && !parser->ast.failed) {
+        parse_top_level(parser);
     }
-    return node;
+    return finish_program(parser, program);
 }
 
-static ASTNode *parse_comparison(void) {
-    ASTNode *node = parse_addition();
- 
-    while (match(TOKEN_COMPARISON) &&
-          (strcmp(current_token.lexeme, "<") == 0 ||
-           strcmp(current_token.lexeme, ">") == 0 ||
-           strcmp(current_token.lexeme, "==") == 0 ||
-           strcmp(current_token.lexeme, "!=") == 0)) {
+Parser *parser_create(void) {
+    Parser *parser = calloc(1, sizeof(*parser));
+    if (!parser) return NULL;
+    ast_init(&parser->ast);
+    return parser;
+}
 
-        Token operator_token = current_token;
-        advance();
+void parser_destroy(Parser *parser) {
+    if (!parser) return;
+    ast_free(&parser->ast);
+    free(parser->statements);
+    free(parser->pending);
+    free(parser->frames);
+    free(parser->operators);
+    free(parser->diagnostics);
+    free(parser->messages);
+    free(parser);
+}
+
+// Forget the previous parse, keeping every buffer for reuse
+static void parser_reset(Parser *parser, const char *input) {
+    parser->source = input;
+    ast_reset(&parser->ast);
+    parser->statement_count = 0;
+    parser->pending_count = 0;
+    parser->frame_count = 0;
+    parser->operator_count = 0;
+    parser->depth = 0;
+    parser->diagnostic_count = 0;
+}
 
-        ASTNode *new_node = create_node(AST_COMPOP);
-        new_node->token = operator_token;
-        new_node->left = node;
-        new_node->right = parse_addition();
-        node = new_node;
+// Parse `input`, lexing on demand; identifiers and literals are interned
+// into `atoms`
+NodeId parser_parse(Parser *parser, const char *input, InternTable *atoms) {
+    parser_reset(parser, input);
+    parser->tokens = NULL;
+    lexer_init(&parser->lexer, input, atoms);
+    advance(parser); // Get first token
+    parser->previous_token = start_of_input;
+    return parse_program(parser);
+}
+
+// Parse over tokens already lexed from `input`
+NodeId parser_parse_tokens(Parser *parser, const char *input, const TokenBuffer *tokens) {
+    parser_reset(parser, input);
+    parser->tokens = tokens;
+    parser->token_index = 0;
+    advance(parser); // Get first token
+    parser->previous_token = start_of_input;
+    return parse_program(parser);
+}
+
+// Number of statements starting at or before `offset`
+static uint32_t statements_before(const Parser *parser, uint32_t offset) {
+    uint32_t low = 0, high = parser->statement_count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (parser->statements[middle].start <= offset) low = middle + 1;
+        else high = middle;
     }
-    return node;
+    return low;
 }
 
-static ASTNode *parse_expression(void) {
-    return parse_comparison();
-}
-
-static ASTNode *parse_primary(void) {
-    ASTNode *node;
-
-    if (match(TOKEN_NUMBER)) {
-        node = create_node(AST_NUMBER);
-        advance();
-    } else if (match(TOKEN_IDENTIFIER)) {
-        node = create_node(AST_IDENTIFIER);
-        advance();
-    } else if (match(TOKEN_LPAREN)) {
-        advance();
-        node = parse_comparison();
-        expect(TOKEN_RPAREN, PARSE_ERROR_MISSING_RPAREN);
-    } else if (match(TOKEN_STRING)) {  // Handle string literals
-        node = create_node(AST_STRING);
-        advance();
-    } else if (match(TOKEN_CHAR)) {  // Handle string literals
-        node = create_node(AST_CHAR);
-        advance();
-    } else {
-        parse_error(PARSE_ERROR_INVALID_EXPRESSION, current_token);
-        synchronize();
-        return create_node(AST_ERROR);
+// Replace items [from, to) of an array of `count` items with the `added`
+// items stored right after it; returns 0 if out of memory
+static int splice(void *items, uint32_t count, uint32_t from, uint32_t to, uint32_t added, size_t size) {
+    if (to == count && added == 0) return 1;
+    char *bytes = items;
+    char *saved = NULL;
+    if (added) {
+        saved = malloc(added * size);
+        if (!saved) return 0;
+        memcpy(saved, bytes + count * size, added * size);
     }
-    return node;
+    if (from + added != to) {
+        memmove(bytes + (from + added) * size, bytes + to * size, (count - to) * size);
+    }
+    if (added) {
+        memcpy(bytes + from * size, saved, added * size);
+        free(saved);
+    }
+    return 1;
 }
 
-// Parse program (multiple statements)
-ASTNode *parse_program(void) {
-    ASTNode *program = create_node(AST_PROGRAM);
-    ASTNode *current = program;
-
-    while (!match(TOKEN_EOF)) {
-        current->left = parse_statement();
-        if (!match(TOKEN_EOF)) {
-            current->right = create_node(AST_PROGRAM);
-            current = current->right;
+// Whether a statement's recorded start is exact: it is the end of the
+// token before, which for a quoted literal lies past offset + length. In
+// practice every statement but the first follows a ';' or '}'.
+static int restartable(uint8_t lexer_state) {
+    return lexer_state == TOKEN_EOF || lexer_state == TOKEN_SEMICOLON || lexer_state == TOKEN_RBRACE;
+}
+
+// Statements are parsed again from one before the statement the edit
+// starts in (a statement's parse looks at the next statement's first
+// token) until the parser reaches, between statements, a token that starts
+// an old statement after the edit in the same lexer state. From there on
+// the text, and so the old parse, is unchanged but for its position. The
+// new statements' nodes, edges and diagnostics are parsed after the old
+// ones and then spliced into place, so the pool ends up laid out exactly
+// as a full parse would lay it out.
+NodeId parser_reparse(Parser *parser, const char *input, InternTable *atoms, TextEdit edit) {
+    Ast *ast = &parser->ast;
+    if (ast->root == AST_NO_NODE || ast->failed) {
+        return parser_parse(parser, input, atoms);
+    }
+
+    // The old tree without its root, which is the last node
+    const ASTNode *root = ast_node(ast, ast->root);
+    Token program = {root->token_type, root->error, root->offset, root->length, root->line, root->atom};
+    uint32_t statement_count = parser->statement_count;
+    uint32_t node_count = ast->root;
+    uint32_t edge_count = root->first_child;
+    uint32_t diagnostic_count = parser->diagnostic_count;
+
+    parser->source = input;
+    parser->tokens = NULL;
+    parser->pending_count = 0;
+    parser->frame_count = 0;
+    parser->operator_count = 0;
+    parser->depth = 0;
+    for (uint32_t i = 0; i < statement_count; i++) {
+        push_child(parser, ast_child(ast, ast->root, i));
+    }
+    ast->count = node_count;
+    ast->child_total = edge_count;
+    ast->root = AST_NO_NODE;
+
+    // Lex from the end of the token before the first statement parsed again
+    uint32_t before = statements_before(parser, edit.offset);
+    uint32_t first = before > 1 ? before - 2 : 0;
+    while (first > 0 && !restartable(parser->statements[first].lexer_state)) first--;
+    Statement restart = {start_of_input.offset, start_of_input.line, start_of_input.type, 0, 0, 0};
+    if (first < statement_count) restart = parser->statements[first];
+    uint32_t line_start = restart.start;
+    while (line_start > 0 && input[line_start - 1] != '\n') line_start--;
+    lexer_init(&parser->lexer, input, atoms);
+    parser->lexer.pos = restart.start;
+    parser->lexer.line = restart.line;
+    parser->lexer.line_start = line_start;
+    parser->lexer.last_type = restart.lexer_state;
+    advance(parser);
+    parser->previous_token = (Token){restart.lexer_state, ERROR_NONE, restart.start, 0, restart.line, ATOM_NONE};
+    if (first == 0) program = parser->current_token;
+    push_frame(parser, AST_PROGRAM, program);
+
+    // Old text from `unchanged` on is still there, `delta` bytes later
+    uint32_t unchanged = edit.offset + edit.removed;
+    uint32_t delta = edit.inserted - edit.removed;
+    uint32_t resume = first;
+    int resynced = 0;
+    while (!match(parser, TOKEN_EOF) && !ast->failed) {
+        Token previous = parser->previous_token;
+        uint32_t start = previous.offset + previous.length;
+        while (resume < statement_count && (parser->statements[resume].start < unchanged ||
+                                            parser->statements[resume].start + delta < start)) {
+            resume++;
         }
+        if (resume < statement_count && parser->statements[resume].start + delta == start &&
+            parser->statements[resume].lexer_state == lexer_state(parser) &&
+            restartable(parser->statements[resume].lexer_state)) {
+            resynced = 1;
+            break;
+        }
+        parse_top_level(parser);
+    }
+    if (ast->failed) {
+        render_diagnostics(parser);
+        return AST_NO_NODE;
+    }
+    if (!resynced) resume = statement_count;
+    int line_delta = resynced ? parser->previous_token.line - parser->statements[resume].line : 0;
+
+    // Replace old statements [first, resume) with the new ones
+    Statement end = {0};
+    end.first_node = node_count;
+    end.first_edge = edge_count;
+    end.first_diagnostic = diagnostic_count;
+    Statement from = first < statement_count ? parser->statements[first] : end;
+    Statement to = resume < statement_count ? parser->statements[resume] : end;
+    uint32_t added_nodes = ast->count - node_count;
+    uint32_t added_edges = ast->child_total - edge_count;
+    uint32_t added_statements = parser->statement_count - statement_count;
+    uint32_t added_diagnostics = parser->diagnostic_count - diagnostic_count;
+    if (!splice(ast->nodes, node_count, from.first_node, to.first_node, added_nodes, sizeof(*ast->nodes)) ||
+        !splice(ast->children, edge_count, from.first_edge, to.first_edge, added_edges, sizeof(*ast->children)) ||
+        !splice(parser->statements, statement_count, first, resume, added_statements, sizeof(*parser->statements)) ||
+        !splice(parser->pending, statement_count, first, resume, added_statements, sizeof(*parser->pending)) ||
+        !splice(parser->diagnostics, diagnostic_count, from.first_diagnostic, to.first_diagnostic,
+                added_diagnostics, sizeof(*parser->diagnostics))) {
+        ast->failed = 1;
+        render_diagnostics(parser);
+        return AST_NO_NODE;
     }
+    ast->count = node_count - (to.first_node - from.first_node) + added_nodes;
+    ast->child_total = edge_count - (to.first_edge - from.first_edge) + added_edges;
+    parser->statement_count = statement_count - (resume - first) + added_statements;
+    parser->pending_count = parser->statement_count;
+    parser->diagnostic_count = diagnostic_count - (to.first_diagnostic - from.first_diagnostic) + added_diagnostics;
+
+    // Renumber: the new statements were built after the old pool, and the
+    // old ones after the edit move by the change in size
+    uint32_t new_nodes = from.first_node - node_count;
+    uint32_t new_edges = from.first_edge - edge_count;
+    uint32_t new_diagnostics = from.first_diagnostic - diagnostic_count;
+    uint32_t moved_nodes = from.first_node + added_nodes - to.first_node;
+    uint32_t moved_edges = from.first_edge + added_edges - to.first_edge;
+    uint32_t moved_diagnostics = from.first_diagnostic + added_diagnostics - to.first_diagnostic;
+    uint32_t new_node_end = from.first_node + added_nodes;
+    uint32_t new_edge_end = from.first_edge + added_edges;
+    uint32_t new_statement_end = first + added_statements;
+    for (uint32_t i = from.first_node; i < new_node_end; i++) {
+        ast->nodes[i].first_child += new_edges;
+    }
+    for (uint32_t i = from.first_edge; i < new_edge_end; i++) {
+        ast->children[i] += new_nodes;
+    }
+    for (uint32_t i = first; i < new_statement_end; i++) {
+        parser->statements[i].first_node += new_nodes;
+        parser->statements[i].first_edge += new_edges;
+        parser->statements[i].first_diagnostic += new_diagnostics;
+        parser->pending[i] += new_nodes;
+    }
+
+    // An edit that keeps the size and lines of the text leaves the rest as is
+    if (moved_edges || delta || line_delta) {
+        for (uint32_t i = new_node_end; i < ast->count; i++) {
+            ASTNode *node = &ast->nodes[i];
+            node->first_child += moved_edges;
+            node->offset += delta;
+            node->line += line_delta;
+        }
+    }
+    if (moved_nodes) {
+        for (uint32_t i = new_edge_end; i < ast->child_total; i++) {
+            ast->children[i] += moved_nodes;
+        }
+    }
+    for (uint32_t i = new_statement_end; i < parser->statement_count; i++) {
+        Statement *statement = &parser->statements[i];
+        statement->start += delta;
+        statement->line += line_delta;
+        statement->first_node += moved_nodes;
+        statement->first_edge += moved_edges;
+        statement->first_diagnostic += moved_diagnostics;
+        parser->pending[i] += moved_nodes;
+    }
+    for (uint32_t i = from.first_diagnostic + added_diagnostics; i < parser->diagnostic_count; i++) {
+        parser->diagnostics[i].token.offset += delta;
+        parser->diagnostics[i].token.line += line_delta;
+    }
+    return finish_program(parser, program);
+}
 
-    return program;
+const Ast *parser_ast(const Parser *parser) {
+    return &parser->ast;
 }
 
-// Initialize parser
-void parser_init(const char *input) {
-    source = input;
-    position = 0;
-    advance(); // Get first token
+const char *parser_diagnostics(const Parser *parser) {
+    return parser->messages ? parser->messages : "";
 }
 
+int parser_error_count(const Parser *parser) {
+    return parser->diagnostic_count;
+}
 
-void print_ast_node(ASTNode* node) {
-    if (!node) {
-        printf("NULL node\n");
+void print_ast_node(Sink* out, const char* source, const Ast* ast, NodeId id) {
+    if (id == AST_NO_NODE) {
+        sink_puts(out, "NULL node\n");
         return;
     }
+    const ASTNode* node = ast_node(ast, id);
 
-    printf("ASTNode Type: ");
+    sink_puts(out, "ASTNode Type: ");
     switch (node->type) {
-        case AST_PROGRAM:    printf("AST_PROGRAM\n"); break;
-        case AST_VARDECL:    printf("AST_VARDECL\n"); break;
-        case AST_ASSIGN:     printf("AST_ASSIGN\n"); break;
-        case AST_PRINT:      printf("AST_PRINT\n"); break;
-        case AST_NUMBER:     printf("AST_NUMBER\n"); break;
-        case AST_IDENTIFIER: printf("AST_IDENTIFIER\n"); break;
-        case AST_BINOP:      printf("AST_BINOP\n"); break;
-        case AST_COMPOP:     printf("AST_COMPOP\n"); break;
-        case AST_IF:         printf("AST_IF\n"); break;
-        case AST_WHILE:      printf("AST_WHILE\n"); break;
-        case AST_BLOCK:      printf("AST_BLOCK\n"); break;
-        case AST_BLOCK_END:      printf("AST_BLOCK_END\n"); break;
-        case AST_STRING:     printf("AST_STRING\n"); break;
-        case AST_CHAR:       printf("AST_CHAR\n"); break;
-        case AST_REPEAT:     printf("AST_REPEAT\n"); break;
-        case AST_FACTORIAL:  printf("AST_FACTORIAL\n"); break;
-        case AST_ERROR:      printf("AST_ERROR\n"); break;
-        default:             printf("UNKNOWN\n");
-    }
-
-    printf("Token:\n");
-    printf("  Type: ");
-    switch (node->token.type) {
-        case TOKEN_EOF:         printf("TOKEN_EOF\n"); break;
-        case TOKEN_NUMBER:      printf("TOKEN_NUMBER\n"); break;
-        case TOKEN_OPERATOR:    printf("TOKEN_OPERATOR\n"); break;
-        case TOKEN_IDENTIFIER:  printf("TOKEN_IDENTIFIER\n"); break;
-        case TOKEN_EQUALS:      printf("TOKEN_EQUALS\n"); break;
-        case TOKEN_SEMICOLON:   printf("TOKEN_SEMICOLON\n"); break;
-        case TOKEN_LPAREN:      printf("TOKEN_LPAREN\n"); break;
-        case TOKEN_RPAREN:      printf("TOKEN_RPAREN\n"); break;
-        case TOKEN_LBRACE:      printf("TOKEN_LBRACE\n"); break;
-        case TOKEN_RBRACE:      printf("TOKEN_RBRACE\n"); break;
-        case TOKEN_IF:          printf("TOKEN_IF\n"); break;
-        case TOKEN_WHILE:       printf("TOKEN_WHILE\n"); break;
-        case TOKEN_INT:         printf("TOKEN_INT\n"); break;
-        case TOKEN_FLOAT:       printf("TOKEN_FLOAT\n"); break;
-        case TOKEN_CHAR:        printf("TOKEN_CHAR\n"); break;
-        case TOKEN_BOOL:        printf("TOKEN_BOOL\n"); break;
-        case TOKEN_PRINT:       printf("TOKEN_PRINT\n"); break;
-        case TOKEN_COMPARISON:  printf("TOKEN_COMPARISON\n"); break;
-        case TOKEN_REPEAT:      printf("TOKEN_REPEAT\n"); break;
-        case TOKEN_DO:          printf("TOKEN_DO\n"); break;
-        case TOKEN_UNTIL:       printf("TOKEN_UNTIL\n"); break;
-        case TOKEN_ERROR:       printf("TOKEN_ERROR\n"); break;
-        case TOKEN_FACTORIAL:   printf("TOKEN_FACTORIAL\n"); break;
-        case TOKEN_STRING:      printf("TOKEN_STRING\n"); break;
-        default:                printf("UNKNOWN\n");
-    }
-    printf("  Lexeme: %s\n", node->token.lexeme);
-    printf("  Line: %d\n", node->token.line);
-    printf("  Error: ");
-    switch (node->token.error) {
-        case ERROR_NONE:                   printf("ERROR_NONE\n"); break;
-        case ERROR_INVALID_CHAR:           printf("ERROR_INVALID_CHAR\n"); break;
-        case ERROR_INVALID_NUMBER:         printf("ERROR_INVALID_NUMBER\n"); break;
-        case ERROR_CONSECUTIVE_OPERATORS:  printf("ERROR_CONSECUTIVE_OPERATORS\n"); break;
-        case ERROR_CONSECUTIVE_COMPARISON: printf("ERROR_CONSECUTIVE_COMPARISON\n"); break;
-        case ERROR_INVALID_IDENTIFIER:     printf("ERROR_INVALID_IDENTIFIER\n"); break;
-        case ERROR_UNEXPECTED_TOKEN:       printf("ERROR_UNEXPECTED_TOKEN\n"); break;
-        default:                           printf("UNKNOWN\n");
+        case AST_PROGRAM:    sink_puts(out, "AST_PROGRAM\n"); break;
+        case AST_VARDECL:    sink_puts(out, "AST_VARDECL\n"); break;
+        case AST_ASSIGN:     sink_puts(out, "AST_ASSIGN\n"); break;
+        case AST_PRINT:      sink_puts(out, "AST_PRINT\n"); break;
+        case AST_NUMBER:     sink_puts(out, "AST_NUMBER\n"); break;
+        case AST_IDENTIFIER: sink_puts(out, "AST_IDENTIFIER\n"); break;
+        case AST_BINOP:      sink_puts(out, "AST_BINOP\n"); break;
+        case AST_COMPOP:     sink_puts(out, "AST_COMPOP\n"); break;
+        case AST_IF:         sink_puts(out, "AST_IF\n"); break;
+        case AST_WHILE:      sink_puts(out, "AST_WHILE\n"); break;
+        case AST_BLOCK:      sink_puts(out, "AST_BLOCK\n"); break;
+        case AST_STRING:     sink_puts(out, "AST_STRING\n"); break;
+        case AST_CHAR:       sink_puts(out, "AST_CHAR\n"); break;
+        case AST_REPEAT:     sink_puts(out, "AST_REPEAT\n"); break;
+        case AST_FACTORIAL:  sink_puts(out, "AST_FACTORIAL\n"); break;
+        case AST_ERROR:      sink_puts(out, "AST_ERROR\n"); break;
+        default:             sink_puts(out, "UNKNOWN\n");
+    }
+
+    sink_puts(out, "Token:\n");
+    sink_puts(out, "  Type: ");
+    switch (node->token_type) {
+        case TOKEN_EOF:         sink_puts(out, "TOKEN_EOF\n"); break;
+        case TOKEN_NUMBER:      sink_puts(out, "TOKEN_NUMBER\n"); break;
+        case TOKEN_OPERATOR:    sink_puts(out, "TOKEN_OPERATOR\n"); break;
+        case TOKEN_IDENTIFIER:  sink_puts(out, "TOKEN_IDENTIFIER\n"); break;
+        case TOKEN_EQUALS:      sink_puts(out, "TOKEN_EQUALS\n"); break;
+        case TOKEN_SEMICOLON:   sink_puts(out, "TOKEN_SEMICOLON\n"); break;
+        case TOKEN_LPAREN:      sink_puts(out, "TOKEN_LPAREN\n"); break;
+        case TOKEN_RPAREN:      sink_puts(out, "TOKEN_RPAREN\n"); break;
+        case TOKEN_LBRACE:      sink_puts(out, "TOKEN_LBRACE\n"); break;
+        case TOKEN_RBRACE:      sink_puts(out, "TOKEN_RBRACE\n"); break;
+        case TOKEN_IF:          sink_puts(out, "TOKEN_IF\n"); break;
+        case TOKEN_WHILE:       sink_puts(out, "TOKEN_WHILE\n"); break;
+        case TOKEN_INT:         sink_puts(out, "TOKEN_INT\n"); break;
+        case TOKEN_FLOAT:       sink_puts(out, "TOKEN_FLOAT\n"); break;
+        case TOKEN_CHAR:        sink_puts(out, "TOKEN_CHAR\n"); break;
+        case TOKEN_BOOL:        sink_puts(out, "TOKEN_BOOL\n"); break;
+        case TOKEN_PRINT:       sink_puts(out, "TOKEN_PRINT\n"); break;
+        case TOKEN_COMPARISON:  sink_puts(out, "TOKEN_COMPARISON\n"); break;
+        case TOKEN_REPEAT:      sink_puts(out, "TOKEN_REPEAT\n"); break;
+        case TOKEN_DO:          sink_puts(out, "TOKEN_DO\n"); break;
+        case TOKEN_UNTIL:       sink_puts(out, "TOKEN_UNTIL\n"); break;
+        case TOKEN_ERROR:       sink_puts(out, "TOKEN_ERROR\n"); break;
+        case TOKEN_FACTORIAL:   sink_puts(out, "TOKEN_FACTORIAL\n"); break;
+        case TOKEN_STRING:      sink_puts(out, "TOKEN_STRING\n"); break;
+        default:                sink_puts(out, "UNKNOWN\n");
+    }
+    TokenText lexeme = ast_text(source, node);
+    sink_printf(out, "  Lexeme: %.*s\n", lexeme.length, lexeme.text);
+    sink_printf(out, "  Line: %d\n", node->line);
+    sink_puts(out, "  Error: ");
+    switch (node->error) {
+        case ERROR_NONE:                   sink_puts(out, "ERROR_NONE\n"); break;
+        case ERROR_INVALID_CHAR:           sink_puts(out, "ERROR_INVALID_CHAR\n"); break;
+        case ERROR_INVALID_NUMBER:         sink_puts(out, "ERROR_INVALID_NUMBER\n"); break;
+        case ERROR_CONSECUTIVE_OPERATORS:  sink_puts(out, "ERROR_CONSECUTIVE_OPERATORS\n"); break;
+        case ERROR_CONSECUTIVE_COMPARISON: sink_puts(out, "ERROR_CONSECUTIVE_COMPARISON\n"); break;
+        case ERROR_INVALID_IDENTIFIER:     sink_puts(out, "ERROR_INVALID_IDENTIFIER\n"); break;
+        case ERROR_UNEXPECTED_TOKEN:       sink_puts(out, "ERROR_UNEXPECTED_TOKEN\n"); break;
+        default:                           sink_puts(out, "UNKNOWN\n");
     }
 }
 
 
-// Print AST (for debugging)
-void print_ast(ASTNode *node, int level) {
-    if (!node) return;
+typedef struct {
+    Sink *out;
+    const char *source;
+    int level;                  // Indentation of the walk's root
+} PrintContext;
+
+static AstWalkAction print_node(const Ast *ast, NodeId id, uint32_t depth, void *context) {
+    const PrintContext *print = context;
+    Sink *out = print->out;
+    const ASTNode *node = ast_node(ast, id);
+    TokenText lexeme = ast_text(print->source, node);
 
     // Indent based on level
-    for (int i = 0; i < level; i++) printf("  ");
+    for (uint32_t i = 0; i < print->level + depth; i++) sink_puts(out, "  ");
 
     // Print node info
     switch (node->type) {
         case AST_PROGRAM:
-            printf("Program\n");
+            sink_puts(out, "Program\n");
             break;
         case AST_VARDECL:
-            printf("VarDecl: %s\n", node->token.lexeme);
+            sink_printf(out, "VarDecl: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_ASSIGN:
-            printf("Assign\n");
+            sink_puts(out, "Assign\n");
             break;
         case AST_NUMBER:
-            printf("Number: %s\n", node->token.lexeme);
+            sink_printf(out, "Number: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_IDENTIFIER:
-            printf("Identifier: %s\n", node->token.lexeme);
+            sink_printf(out, "Identifier: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_BINOP:
-            printf("Binary Operator: %s\n", node->token.lexeme);
+            sink_printf(out, "Binary Operator: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_COMPOP:
-            printf("Comparison Operator: %s\n", node->token.lexeme);
+            sink_printf(out, "Comparison Operator: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_IF:
-            printf("If: %s\n", node->token.lexeme);
+            sink_printf(out, "If: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_BLOCK:
-            printf("Block: %s\n", node->token.lexeme);
-            break;
-        case AST_BLOCK_END:
-            printf("Block End: %s\n", node->token.lexeme);
+            sink_printf(out, "Block: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_WHILE:
-            printf("While: %s\n", node->token.lexeme); 
+            sink_printf(out, "While: %.*s\n", lexeme.length, lexeme.text); 
             break;
         case AST_REPEAT:
-            printf("Repeat-Until: %s\n", node->token.lexeme);
+            sink_printf(out, "Repeat-Until: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_FACTORIAL:
-            printf("Factorial: %s\n", node->token.lexeme);
+            sink_printf(out, "Factorial: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_STRING:
-            printf("String: %s\n", node->token.lexeme);
+            sink_printf(out, "String: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_CHAR:
-            printf("Char: %s\n", node->token.lexeme);
+            sink_printf(out, "Char: %.*s\n", lexeme.length, lexeme.text);
             break;
         case AST_PRINT:
-            printf("Print\n");
+            sink_puts(out, "Print\n");
             break;
         case AST_ERROR:
-            printf("Error Node\n");
+            sink_puts(out, "Error Node\n");
             break;
         default:
-            printf("Unknown node type\n");
+            sink_puts(out, "Unknown node type\n");
     }
 
-    print_ast(node->left, level + 1);
-    print_ast(node->right, level + 1);
+    return AST_WALK_CONTINUE;
 }
 
-// Free AST memory
-void free_ast(ASTNode *node) {
-    if (!node) return;
-    free_ast(node->left);
-    free_ast(node->right);
-    free(node);
+// Print AST (for debugging)
+void print_ast(Sink *out, const char *source, const Ast *ast, NodeId id, int level) {
+    PrintContext print = {out, source, level};
+    if (!ast_walk(ast, id, print_node, NULL, &print)) {
+        sink_puts(out, "Out of memory while printing the AST\n");
+    }
+}
+
+static const char *json_type_name(uint8_t type) {
+    switch (type) {
+        case AST_PROGRAM:    return "Program";
+        case AST_VARDECL:    return "VarDecl";
+        case AST_ASSIGN:     return "Assign";
+        case AST_PRINT:      return "Print";
+        case AST_NUMBER:     return "Number";
+        case AST_IDENTIFIER: return "Identifier";
+        case AST_BINOP:      return "BinaryOperator";
+        case AST_COMPOP:     return "ComparisonOperator";
+        case AST_IF:         return "If";
+        case AST_WHILE:      return "While";
+        case AST_BLOCK:      return "Block";
+        case AST_STRING:     return "String";
+        case AST_REPEAT:     return "RepeatUntil";
+        case AST_FACTORIAL:  return "Factorial";
+        case AST_ERROR:      return "Error";
+        case AST_CHAR:       return "Char";
+        default:             return "Unknown";
+    }
+}
+
+// Bytes outside ASCII are copied as they are
+void json_write_string(Sink *out, const char *text, size_t length) {
+    size_t run = 0;
+    sink_puts(out, "\"");
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f) continue;
+        sink_write(out, text + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':  sink_puts(out, "\\\""); break;
+            case '\\': sink_puts(out, "\\\\"); break;
+            case '\n': sink_puts(out, "\\n"); break;
+            case '\t': sink_puts(out, "\\t"); break;
+            case '\r': sink_puts(out, "\\r"); break;
+            default:   sink_printf(out, "\\u%04x", c);
+        }
+    }
+    sink_write(out, text + run, length - run);
+    sink_puts(out, "\"");
+}
+
+typedef struct {
+    Sink *out;
+    const char *source;
+    int first;                  // The next node is the first of its siblings
+} JsonContext;
+
+static AstWalkAction json_enter(const Ast *ast, NodeId id, uint32_t depth, void *context) {
+    JsonContext *json = context;
+    const ASTNode *node = ast_node(ast, id);
+    TokenText lexeme = ast_text(json->source, node);
+    (void)depth;
+
+    if (!json->first) sink_puts(json->out, ",");
+    sink_printf(json->out, "{\"type\":\"%s\",\"line\":%d,\"text\":", json_type_name(node->type), node->line);
+    json_write_string(json->out, lexeme.text, lexeme.length);
+    sink_puts(json->out, ",\"children\":[");
+    json->first = 1;
+    return AST_WALK_CONTINUE;
+}
+
+static void json_leave(const Ast *ast, NodeId id, uint32_t depth, void *context) {
+    JsonContext *json = context;
+    (void)ast;
+    (void)id;
+    (void)depth;
+    sink_puts(json->out, "]}");
+    json->first = 0;
+}
+
+int print_ast_json(Sink *out, const char *source, const Ast *ast, NodeId id) {
+    JsonContext json = {out, source, 1};
+    return ast_walk(ast, id, json_enter, json_leave, &json);
 }
 
 // // Main function for testing
@@ -625,13 +1190,22 @@ void free_ast(ASTNode *node) {
 //     fclose(fp);
 
 //     printf("Parsing input:\n%s\n", file_buffer);
-//     parser_init(file_buffer);
-//     ASTNode *ast = parse_program();
+//     InternTable atoms;
+//     Parser *parser = parser_create();
+//     if (!parser || !intern_init(&atoms)) {
+//         fprintf(stderr, "Memory allocation error for the parser");
+//         parser_destroy(parser);
+//         free(file_buffer);
+//         return 1;
+//     }
+//     NodeId root = parser_parse(parser, file_buffer, &atoms);
+//     fputs(parser_diagnostics(parser), stdout);
 
 //     printf("\nAbstract Syntax Tree:\n");
-//     print_ast(ast, 0);
+//     print_ast(NULL, file_buffer, parser_ast(parser), root, 0);
 
-//     free_ast(ast);
+//     parser_destroy(parser);
+//     intern_free(&atoms);
 //     free(file_buffer);
 //     return 0;
 // }
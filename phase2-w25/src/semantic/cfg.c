@@ -0,0 +1,270 @@
+/* cfg.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/cfg.h"
+
+#define CFG_INITIAL_CAPACITY 64
+
+// An if, while or repeat whose children are being walked
+typedef struct {
+    NodeId node;
+    // if: the block that ends with the condition, once the body starts
+    // while: the loop header, where the condition is tested
+    // repeat: the first block of the body
+    BlockId block;
+} ControlFrame;
+
+typedef struct {
+    BlockId from;
+    BlockId to;
+} CfgEdge;
+
+typedef struct {
+    Cfg* cfg;
+    const Resolution* resolution;
+    BlockId current;            // Block that events are added to
+    NodeId target;              // Name assigned by the assignment being walked
+    uint32_t* slots;            // Slot of each declaration, indexed by NodeId
+    uint32_t visible;           // Variables visible at this point
+    uint32_t block_capacity;
+    uint32_t event_capacity;
+    CfgEdge* edges;
+    uint32_t edge_capacity;
+    ControlFrame* frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+    uint32_t* marks;            // `visible` where each open block scope began
+    uint32_t mark_count;
+    uint32_t mark_capacity;
+    int failed;                 // Out of memory
+} CfgBuilder;
+
+// Make room for one more `size`-byte element in a growable array
+static int reserve(void** array, uint32_t count, uint32_t* capacity, size_t size) {
+    if (count < *capacity) return 1;
+    uint32_t grown = *capacity ? *capacity * 2 : CFG_INITIAL_CAPACITY;
+    void* larger = realloc(*array, (size_t)grown * size);
+    if (!larger) return 0;
+    *array = larger;
+    *capacity = grown;
+    return 1;
+}
+
+// Close the current block and start a new one, which becomes current
+static BlockId start_block(CfgBuilder* builder) {
+    Cfg* cfg = builder->cfg;
+    if (!reserve((void**)&cfg->blocks, cfg->block_count, &builder->block_capacity, sizeof(BasicBlock))) {
+        builder->failed = 1;
+        return builder->current;
+    }
+    if (builder->current != CFG_NO_BLOCK) {
+        BasicBlock* closed = &cfg->blocks[builder->current];
+        closed->event_count = cfg->event_count - closed->first_event;
+    }
+    BlockId id = cfg->block_count++;
+    memset(&cfg->blocks[id], 0, sizeof(BasicBlock));
+    cfg->blocks[id].first_event = cfg->event_count;
+    builder->current = id;
+    return id;
+}
+
+static void add_edge(CfgBuilder* builder, BlockId from, BlockId to) {
+    if (!reserve((void**)&builder->edges, builder->cfg->edge_count, &builder->edge_capacity, sizeof(CfgEdge))) {
+        builder->failed = 1;
+        return;
+    }
+    builder->edges[builder->cfg->edge_count++] = (CfgEdge){from, to};
+}
+
+static void add_event(CfgBuilder* builder, NodeId node, uint32_t slot, CfgEventKind kind) {
+    Cfg* cfg = builder->cfg;
+    if (!reserve((void**)&cfg->events, cfg->event_count, &builder->event_capacity, sizeof(CfgEvent))) {
+        builder->failed = 1;
+        return;
+    }
+    cfg->events[cfg->event_count++] = (CfgEvent){node, slot, (uint8_t)kind};
+}
+
+// A new block, reached from the current one
+static BlockId follow(CfgBuilder* builder) {
+    BlockId from = builder->current;
+    BlockId to = start_block(builder);
+    add_edge(builder, from, to);
+    return to;
+}
+
+static void push_frame(CfgBuilder* builder, NodeId node, BlockId block) {
+    if (!reserve((void**)&builder->frames, builder->frame_count, &builder->frame_capacity, sizeof(ControlFrame))) {
+        builder->failed = 1;
+        return;
+    }
+    builder->frames[builder->frame_count++] = (ControlFrame){node, block};
+}
+
+static AstWalkAction build_enter(const Ast* ast, NodeId id, uint32_t depth, void* context) {
+    CfgBuilder* builder = context;
+    const Resolution* resolution = builder->resolution;
+    (void)depth;
+    if (builder->failed) return AST_WALK_SKIP;
+
+    // The body of an if or while starts once its condition is done
+    if (builder->frame_count > 0) {
+        ControlFrame* frame = &builder->frames[builder->frame_count - 1];
+        ASTNodeType type = ast_node(ast, frame->node)->type;
+        if ((type == AST_IF || type == AST_WHILE) && ast_child(ast, frame->node, 1) == id) {
+            if (type == AST_IF) frame->block = builder->current;
+            follow(builder);
+        }
+    }
+
+    switch (ast_node(ast, id)->type) {
+        case AST_VARDECL:
+            // Repeated declarations declare nothing
+            if (resolution->declarations[id] == id) {
+                builder->slots[id] = builder->visible++;
+                if (builder->visible > builder->cfg->slot_count) builder->cfg->slot_count = builder->visible;
+                add_event(builder, id, builder->slots[id], CFG_DECLARE);
+            }
+            return AST_WALK_SKIP;
+        case AST_ASSIGN:
+            builder->target = ast_child(ast, id, 0);
+            break;
+        case AST_BLOCK:
+            if (!reserve((void**)&builder->marks, builder->mark_count, &builder->mark_capacity, sizeof(uint32_t))) {
+                builder->failed = 1;
+                break;
+            }
+            builder->marks[builder->mark_count++] = builder->visible;
+            break;
+        case AST_IF:
+            push_frame(builder, id, CFG_NO_BLOCK);
+            break;
+        case AST_WHILE:
+        case AST_REPEAT:
+            push_frame(builder, id, follow(builder));
+            break;
+        default:
+            break;
+    }
+    return AST_WALK_CONTINUE;
+}
+
+static void build_leave(const Ast* ast, NodeId id, uint32_t depth, void* context) {
+    CfgBuilder* builder = context;
+    const Resolution* resolution = builder->resolution;
+    const ASTNode* node = ast_node(ast, id);
+    NodeId declaration;
+    ControlFrame frame;
+    (void)depth;
+    if (builder->failed) return;
+
+    switch (node->type) {
+        case AST_IDENTIFIER:
+            declaration = resolution->declarations[id];
+            if (id != builder->target && declaration != AST_NO_NODE) {
+                add_event(builder, id, builder->slots[declaration], CFG_USE);
+            }
+            break;
+        case AST_ASSIGN:
+            declaration = builder->target == AST_NO_NODE ? AST_NO_NODE : resolution->declarations[builder->target];
+            if (declaration != AST_NO_NODE) {
+                add_event(builder, id, builder->slots[declaration], CFG_ASSIGN);
+            }
+            builder->target = AST_NO_NODE;
+            break;
+        case AST_BLOCK:
+            if (builder->mark_count > 0) builder->visible = builder->marks[--builder->mark_count];
+            break;
+        case AST_IF:
+            // Both the body and skipping it lead on; without a body (after
+            // a syntax error) there is nothing to join
+            frame = builder->frames[--builder->frame_count];
+            if (frame.block != CFG_NO_BLOCK) {
+                follow(builder);
+                add_edge(builder, frame.block, builder->current);
+            }
+            break;
+        case AST_WHILE:
+            // Back to the test, which also leads out of the loop
+            frame = builder->frames[--builder->frame_count];
+            add_edge(builder, builder->current, frame.block);
+            start_block(builder);
+            add_edge(builder, frame.block, builder->current);
+            break;
+        case AST_REPEAT:
+            // The test at the end of the body loops back or leads out
+            frame = builder->frames[--builder->frame_count];
+            add_edge(builder, builder->current, frame.block);
+            follow(builder);
+            break;
+        default:
+            break;
+    }
+}
+
+// Lay the edges out as successor lists, then predecessor lists
+static int link_edges(Cfg* cfg, const CfgEdge* edges) {
+    cfg->edges = malloc(((size_t)cfg->edge_count * 2 + 1) * sizeof(BlockId));
+    if (!cfg->edges) return 0;
+    for (uint32_t i = 0; i < cfg->edge_count; i++) {
+        cfg->blocks[edges[i].from].successor_count++;
+        cfg->blocks[edges[i].to].predecessor_count++;
+    }
+    uint32_t successor_at = 0, predecessor_at = cfg->edge_count;
+    for (BlockId b = 0; b < cfg->block_count; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        block->first_successor = successor_at;
+        block->first_predecessor = predecessor_at;
+        successor_at += block->successor_count;
+        predecessor_at += block->predecessor_count;
+        block->successor_count = 0;
+        block->predecessor_count = 0;
+    }
+    for (uint32_t i = 0; i < cfg->edge_count; i++) {
+        BasicBlock* from = &cfg->blocks[edges[i].from];
+        BasicBlock* to = &cfg->blocks[edges[i].to];
+        cfg->edges[from->first_successor + from->successor_count++] = edges[i].to;
+        cfg->edges[to->first_predecessor + to->predecessor_count++] = edges[i].from;
+    }
+    return 1;
+}
+
+int cfg_build(Cfg* cfg, const Ast* ast, const Resolution* resolution) {
+    memset(cfg, 0, sizeof(*cfg));
+    CfgBuilder builder = {0};
+    builder.cfg = cfg;
+    builder.resolution = resolution;
+    builder.current = CFG_NO_BLOCK;
+    builder.target = AST_NO_NODE;
+    builder.slots = malloc((ast->count ? ast->count : 1) * sizeof(uint32_t));
+    builder.failed = builder.slots == NULL;
+
+    if (!builder.failed) {
+        cfg->entry = start_block(&builder);
+        if (!ast_walk(ast, ast->root, build_enter, build_leave, &builder)) builder.failed = 1;
+    }
+    if (!builder.failed) {
+        cfg->exit = builder.current;
+        BasicBlock* last = &cfg->blocks[cfg->exit];
+        last->event_count = cfg->event_count - last->first_event;
+        builder.failed = !link_edges(cfg, builder.edges);
+    }
+
+    free(builder.slots);
+    free(builder.edges);
+    free(builder.frames);
+    free(builder.marks);
+    if (builder.failed) {
+        cfg_free(cfg);
+        return 0;
+    }
+    return 1;
+}
+
+void cfg_free(Cfg* cfg) {
+    free(cfg->blocks);
+    free(cfg->events);
+    free(cfg->edges);
+    memset(cfg, 0, sizeof(*cfg));
+}
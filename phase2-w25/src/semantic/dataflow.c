@@ -0,0 +1,205 @@
+/* dataflow.c */
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/dataflow.h"
+
+#define NO_RANK UINT32_MAX
+
+// Lowest pending rank at or after `rank`, or NO_RANK
+static uint32_t next_pending(const uint64_t* pending, uint32_t rank, uint32_t count) {
+    uint32_t word = rank / DATAFLOW_WORD_BITS;
+    uint32_t words = DATAFLOW_WORDS(count);
+    if (word >= words) return NO_RANK;
+    uint64_t bits = pending[word] & (~(uint64_t)0 << (rank % DATAFLOW_WORD_BITS));
+    while (bits == 0) {
+        if (++word == words) return NO_RANK;
+        bits = pending[word];
+    }
+    return word * DATAFLOW_WORD_BITS + (uint32_t)__builtin_ctzll(bits);
+}
+
+// The worklist is kept by rank, the order blocks are best visited in:
+// block numbers going forward, and the reverse of them going backward.
+// Each visit meets the neighbours' sets into the block's, applies the
+// transfer, and requeues the blocks downstream if the result changed.
+// Blocks requeued behind the current rank, around a loop, wait for the
+// next sweep rather than restarting this one there: in a deep loop nest,
+// restarting would carry each new fact through every inner loop on its own.
+int dataflow_solve(const Cfg* cfg, const DataflowProblem* problem, DataflowSets* sets) {
+    uint32_t count = cfg->block_count;
+    uint32_t words = DATAFLOW_WORDS(cfg->slot_count);
+    if (words == 0) words = 1;
+    size_t size = (size_t)count * words;
+    sets->words = words;
+    sets->in = malloc(size * sizeof(uint64_t));
+    sets->out = malloc(size * sizeof(uint64_t));
+    uint64_t* scratch = malloc(words * sizeof(uint64_t));
+    uint64_t* pending = calloc(DATAFLOW_WORDS(count) + 1, sizeof(uint64_t));
+    if (!sets->in || !sets->out || !scratch || !pending) {
+        free(scratch);
+        free(pending);
+        dataflow_free(sets);
+        return 0;
+    }
+
+    int forward = problem->direction == DATAFLOW_FORWARD;
+    int intersect = problem->meet == DATAFLOW_INTERSECTION;
+    // Facts come into a block on one side and leave on the other
+    uint64_t* entering = forward ? sets->in : sets->out;
+    uint64_t* leaving = forward ? sets->out : sets->in;
+    // Before a block is first visited, it passes on everything it could,
+    // so that it does not hold back the meet of blocks it loops back to
+    memset(leaving, intersect ? 0xff : 0, size * sizeof(uint64_t));
+    memset(entering, 0, size * sizeof(uint64_t));
+    for (uint32_t rank = 0; rank < count; rank++) bitset_set(pending, rank);
+
+    uint32_t rank = 0;
+    for (;;) {
+        rank = next_pending(pending, rank, count);
+        // The sweep is done; start the next one
+        if (rank == NO_RANK) rank = next_pending(pending, 0, count);
+        if (rank == NO_RANK) break;
+        bitset_clear(pending, rank);
+        BlockId block = forward ? rank : count - 1 - rank;
+        const BasicBlock* node = &cfg->blocks[block];
+        const BlockId* sources = forward ? cfg_predecessors(cfg, block) : cfg_successors(cfg, block);
+        uint32_t source_count = forward ? node->predecessor_count : node->successor_count;
+        uint64_t* into = entering + (size_t)block * words;
+
+        // No facts hold where the program starts (or ends)
+        if (source_count == 0) {
+            memset(into, 0, words * sizeof(uint64_t));
+        } else {
+            memcpy(into, leaving + (size_t)sources[0] * words, words * sizeof(uint64_t));
+            for (uint32_t i = 1; i < source_count; i++) {
+                const uint64_t* from = leaving + (size_t)sources[i] * words;
+                for (uint32_t w = 0; w < words; w++) {
+                    into[w] = intersect ? into[w] & from[w] : into[w] | from[w];
+                }
+            }
+        }
+
+        memcpy(scratch, into, words * sizeof(uint64_t));
+        problem->transfer(cfg, block, scratch, problem->context);
+        uint64_t* result = leaving + (size_t)block * words;
+        if (memcmp(scratch, result, words * sizeof(uint64_t)) == 0) continue;
+        memcpy(result, scratch, words * sizeof(uint64_t));
+
+        const BlockId* targets = forward ? cfg_successors(cfg, block) : cfg_predecessors(cfg, block);
+        uint32_t target_count = forward ? node->successor_count : node->predecessor_count;
+        for (uint32_t i = 0; i < target_count; i++) {
+            uint32_t target = forward ? targets[i] : count - 1 - targets[i];
+            bitset_set(pending, target);
+        }
+    }
+
+    free(scratch);
+    free(pending);
+    return 1;
+}
+
+void dataflow_free(DataflowSets* sets) {
+    free(sets->in);
+    free(sets->out);
+    sets->in = NULL;
+    sets->out = NULL;
+    sets->words = 0;
+}
+
+// Which assignments count, for definite assignment
+typedef struct {
+    const uint8_t* flags;
+    uint8_t defines;
+} AssignmentContext;
+
+// A declaration starts its slot unassigned, and an assignment that counts
+// assigns it
+static void assign_event(const CfgEvent* event, uint64_t* set, const AssignmentContext* context) {
+    if (event->kind == CFG_DECLARE) {
+        bitset_clear(set, event->slot);
+    } else if (event->kind == CFG_ASSIGN && (context->flags[event->node] & context->defines)) {
+        bitset_set(set, event->slot);
+    }
+}
+
+static void assignment_transfer(const Cfg* cfg, BlockId block, uint64_t* set, void* context) {
+    const BasicBlock* node = &cfg->blocks[block];
+    for (uint32_t i = 0; i < node->event_count; i++) {
+        assign_event(&cfg->events[node->first_event + i], set, context);
+    }
+}
+
+int definite_assignment(const Cfg* cfg, uint8_t* flags, uint8_t defines, uint8_t assigned, uint64_t* at_exit) {
+    AssignmentContext context = {flags, defines};
+    DataflowProblem problem = {DATAFLOW_FORWARD, DATAFLOW_INTERSECTION, assignment_transfer, &context};
+    DataflowSets sets;
+    if (!dataflow_solve(cfg, &problem, &sets)) return 0;
+    uint64_t* set = malloc(sets.words * sizeof(uint64_t));
+    if (!set) {
+        dataflow_free(&sets);
+        return 0;
+    }
+
+    // Replay each block from its entry to see what every use finds
+    for (BlockId b = 0; b < cfg->block_count; b++) {
+        const BasicBlock* node = &cfg->blocks[b];
+        memcpy(set, dataflow_in(&sets, b), sets.words * sizeof(uint64_t));
+        for (uint32_t i = 0; i < node->event_count; i++) {
+            const CfgEvent* event = &cfg->events[node->first_event + i];
+            if (event->kind == CFG_USE && bitset_test(set, event->slot)) flags[event->node] |= assigned;
+            assign_event(event, set, &context);
+        }
+    }
+    if (at_exit) {
+        memcpy(at_exit, dataflow_out(&sets, cfg->exit), DATAFLOW_WORDS(cfg->slot_count) * sizeof(uint64_t));
+    }
+
+    free(set);
+    dataflow_free(&sets);
+    return 1;
+}
+
+// Going backward, a use makes its slot live, and the assignment or
+// declaration before it ends that
+static void live_event(const CfgEvent* event, uint64_t* set) {
+    if (event->kind == CFG_USE) {
+        bitset_set(set, event->slot);
+    } else {
+        bitset_clear(set, event->slot);
+    }
+}
+
+static void liveness_transfer(const Cfg* cfg, BlockId block, uint64_t* set, void* context) {
+    const BasicBlock* node = &cfg->blocks[block];
+    (void)context;
+    for (uint32_t i = node->event_count; i-- > 0;) {
+        live_event(&cfg->events[node->first_event + i], set);
+    }
+}
+
+int liveness(const Cfg* cfg, uint8_t* flags, uint8_t live) {
+    DataflowProblem problem = {DATAFLOW_BACKWARD, DATAFLOW_UNION, liveness_transfer, NULL};
+    DataflowSets sets;
+    if (!dataflow_solve(cfg, &problem, &sets)) return 0;
+    uint64_t* set = malloc(sets.words * sizeof(uint64_t));
+    if (!set) {
+        dataflow_free(&sets);
+        return 0;
+    }
+
+    // Replay each block from its exit to see which stores are read
+    for (BlockId b = 0; b < cfg->block_count; b++) {
+        const BasicBlock* node = &cfg->blocks[b];
+        memcpy(set, dataflow_out(&sets, b), sets.words * sizeof(uint64_t));
+        for (uint32_t i = node->event_count; i-- > 0;) {
+            const CfgEvent* event = &cfg->events[node->first_event + i];
+            if (event->kind == CFG_ASSIGN && bitset_test(set, event->slot)) flags[event->node] |= live;
+            live_event(event, set);
+        }
+    }
+
+    free(set);
+    dataflow_free(&sets);
+    return 1;
+}
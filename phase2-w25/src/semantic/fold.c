@@ -0,0 +1,442 @@
+/* fold.c */
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "../../include/fold.h"
+
+// What folding does with a node, besides turning it into a literal
+#define FOLD_DROPPED 1          // Left out of the folded tree, with its subtree
+#define FOLD_TO_LEFT 2          // Replaced by its left operand
+#define FOLD_TO_RIGHT 4         // Replaced by its right operand
+#define FOLD_KEPT 8             // Reached from the root through nodes that are copied
+
+// The folding pass makes three passes over the node pool, which is in
+// post-order. The first decides, children before parents, what each node
+// folds to: the literal it evaluates to, one of its operands, or nothing.
+// The second goes back down from the root to mark the nodes still needed,
+// and the third builds the folded tree from them.
+typedef struct {
+    const Resolution* resolution;
+    InternTable* atoms;
+    Atom* values;               // Literal each node folds to (ATOM_NONE if none), indexed by NodeId
+    uint8_t* marks;             // FOLD_* bits, indexed by NodeId
+    int changed;                // Some node folds
+    int failed;                 // Out of memory
+} Folder;
+
+// The value of a node that folds to a literal, or NULL
+static const NumberValue* constant(const Folder* folder, NodeId id) {
+    if (id == AST_NO_NODE || folder->values[id] == ATOM_NONE) return NULL;
+    return atom_number(folder->atoms, folder->values[id]);
+}
+
+static int is_zero(const NumberValue* value) {
+    return value->kind == NUMBER_INT ? value->i == 0 : value->f == 0.0;
+}
+
+// Atom of a literal with `value`, its value set if its text is new. Floats
+// get the shortest text that reads back as the same value, with a
+// fraction so that it still reads as a float.
+static Atom literal_atom(Folder* folder, NumberValue value) {
+    char text[40];
+    int length = 0;
+    if (value.kind == NUMBER_INT) {
+        length = snprintf(text, sizeof(text), "%" PRId64, value.i);
+    } else {
+        for (int precision = 15; precision <= 17; precision++) {
+            length = snprintf(text, sizeof(text), "%.*g", precision, value.f);
+            if (strtod(text, NULL) == value.f) break;
+        }
+        if (!strpbrk(text, ".e")) {
+            memcpy(text + length, ".0", 3);
+            length += 2;
+        }
+    }
+    Atom atom = intern(folder->atoms, text, (size_t)length);
+    if (atom == ATOM_NONE) {
+        folder->failed = 1;
+        return ATOM_NONE;
+    }
+    NumberValue* number = &folder->atoms->numbers[atom];
+    if (number->kind == NUMBER_NONE) *number = value;
+    return atom;
+}
+
+// `left op right` for two literals of the same kind. Returns 0 when that
+// is no literal: a division by zero, an int that overflows, or a float
+// that is not finite.
+static int evaluate(Atom op, const NumberValue* left, const NumberValue* right, NumberValue* result) {
+    if (left->kind != right->kind) return 0;
+    int is_int = left->kind == NUMBER_INT;
+    int64_t a = left->i, b = right->i;
+    double x = left->f, y = right->f;
+    result->kind = left->kind;
+    switch (op) {
+        case ATOM_PLUS:
+            if (is_int) return !__builtin_add_overflow(a, b, &result->i);
+            result->f = x + y;
+            break;
+        case ATOM_MINUS:
+            if (is_int) return !__builtin_sub_overflow(a, b, &result->i);
+            result->f = x - y;
+            break;
+        case ATOM_STAR:
+            if (is_int) return !__builtin_mul_overflow(a, b, &result->i);
+            result->f = x * y;
+            break;
+        case ATOM_SLASH:
+            if (is_int) {
+                if (b == 0 || (a == INT64_MIN && b == -1)) return 0;
+                result->i = a / b;
+                return 1;
+            }
+            result->f = x / y;
+            break;
+        default:
+            // Comparisons give a bool, kept as the int 1 or 0
+            result->kind = NUMBER_INT;
+            switch (op) {
+                case ATOM_LT: result->i = is_int ? a < b : x < y; break;
+                case ATOM_GT: result->i = is_int ? a > b : x > y; break;
+                case ATOM_EQ: result->i = is_int ? a == b : x == y; break;
+                case ATOM_NE: result->i = is_int ? a != b : x != y; break;
+                default: return 0;
+            }
+            return 1;
+    }
+    return isfinite(result->f);
+}
+
+// Which operand `left op right` equals when the other one is the literal
+// `value`: FOLD_TO_LEFT or FOLD_TO_RIGHT, or 0 if none. Float x + 0.0 is
+// not x when x is -0.0, so floats only drop a 0.0 subtracted or a 1.0
+// multiplied or divided by.
+static uint8_t identity(Atom op, const NumberValue* value, int value_is_left) {
+    int is_int = value->kind == NUMBER_INT;
+    int zero = is_int ? value->i == 0 : value->f == 0.0 && !signbit(value->f);
+    int one = is_int ? value->i == 1 : value->f == 1.0;
+    uint8_t other = value_is_left ? FOLD_TO_RIGHT : FOLD_TO_LEFT;
+    switch (op) {
+        case ATOM_PLUS:
+            return is_int && zero ? other : 0;
+        case ATOM_MINUS:
+            return zero && !value_is_left ? other : 0;
+        case ATOM_STAR:
+            return one ? other : 0;
+        case ATOM_SLASH:
+            return one && !value_is_left ? other : 0;
+        default:
+            return 0;
+    }
+}
+
+static void fold_binop(const Ast* ast, NodeId id, Folder* folder) {
+    const ASTNode* node = ast_node(ast, id);
+    NodeId left_id = ast_child(ast, id, 0);
+    NodeId right_id = ast_child(ast, id, 1);
+    VarType type = folder->resolution->types[id];
+    // Arithmetic on bools and strings is left alone
+    if (right_id == AST_NO_NODE || (type != TYPE_INT && type != TYPE_FLOAT)) return;
+    const NumberValue* left = constant(folder, left_id);
+    const NumberValue* right = constant(folder, right_id);
+    NumberValue result;
+
+    if (left && right) {
+        if (evaluate(node->atom, left, right, &result)) {
+            folder->values[id] = literal_atom(folder, result);
+            folder->changed = 1;
+        }
+        return;
+    }
+    if (!left && !right) return;
+    // An int multiplied by zero is zero, whatever the other operand was
+    if (node->atom == ATOM_STAR && type == TYPE_INT && is_zero(left ? left : right)) {
+        folder->values[id] = left ? folder->values[left_id] : folder->values[right_id];
+        folder->changed = 1;
+        return;
+    }
+    uint8_t kept = identity(node->atom, left ? left : right, left != NULL);
+    if (kept) {
+        folder->marks[id] |= kept;
+        folder->marks[kept == FOLD_TO_LEFT ? right_id : left_id] |= FOLD_DROPPED;
+        folder->changed = 1;
+    }
+}
+
+static void fold_compop(const Ast* ast, NodeId id, Folder* folder) {
+    NodeId left_id = ast_child(ast, id, 0);
+    NodeId right_id = ast_child(ast, id, 1);
+    const NumberValue* left = constant(folder, left_id);
+    const NumberValue* right = constant(folder, right_id);
+    NumberValue result;
+    if (left && right && folder->resolution->types[left_id] == folder->resolution->types[right_id] &&
+        evaluate(ast_node(ast, id)->atom, left, right, &result)) {
+        folder->values[id] = literal_atom(folder, result);
+        folder->changed = 1;
+    }
+}
+
+// A literal assigned to a variable of the other numeric type is converted
+// as the assignment would convert it: ints to floats, and floats to ints
+// by dropping the fraction
+static void fold_assignment(const Ast* ast, NodeId id, Folder* folder) {
+    NodeId name_id = ast_child(ast, id, 0);
+    NodeId value_id = ast_child(ast, id, 1);
+    const NumberValue* value = constant(folder, value_id);
+    if (!value || folder->resolution->types[value_id] == TYPE_BOOL) return;
+    VarType target = folder->resolution->types[name_id];
+    NumberValue converted;
+    if (target == TYPE_FLOAT && value->kind == NUMBER_INT) {
+        converted.kind = NUMBER_FLOAT;
+        converted.f = (double)value->i;
+    } else if (target == TYPE_INT && value->kind == NUMBER_FLOAT &&
+               value->f > -0x1p63 && value->f < 0x1p63) {
+        converted.kind = NUMBER_INT;
+        converted.i = (int64_t)value->f;
+    } else {
+        return;
+    }
+    folder->values[value_id] = literal_atom(folder, converted);
+    folder->changed = 1;
+}
+
+static void decide(const Ast* ast, NodeId id, Folder* folder) {
+    const ASTNode* node = ast_node(ast, id);
+    const NumberValue* value;
+
+    switch (node->type) {
+        case AST_NUMBER:
+            value = atom_number(folder->atoms, node->atom);
+            if (value->kind == NUMBER_INT || value->kind == NUMBER_FLOAT) folder->values[id] = node->atom;
+            break;
+        case AST_BINOP:
+            fold_binop(ast, id, folder);
+            break;
+        case AST_COMPOP:
+            fold_compop(ast, id, folder);
+            break;
+        case AST_ASSIGN:
+            fold_assignment(ast, id, folder);
+            break;
+        case AST_IF:
+        case AST_WHILE:
+            // A body that never runs goes, with its condition
+            value = constant(folder, ast_child(ast, id, 0));
+            if (value && is_zero(value)) {
+                folder->marks[id] |= FOLD_DROPPED;
+                folder->changed = 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// State of the pass that builds the folded tree
+typedef struct {
+    const Folder* folder;
+    FoldedProgram* folded;
+    NodeId* map;                // Folded node of each node, indexed by NodeId
+    NodeId* children;           // Folded children of the node being built
+    uint32_t child_capacity;
+    size_t text_length;         // Bytes of folded->text in use
+    size_t text_capacity;
+    int failed;
+} Emitter;
+
+// Append a folded literal's text to the folded text; returns its offset
+static uint32_t append_text(Emitter* emitter, const char* text, uint32_t length) {
+    FoldedProgram* folded = emitter->folded;
+    if (emitter->text_length + length + 1 > emitter->text_capacity) {
+        size_t capacity = emitter->text_capacity * 2 + length + 1;
+        char* grown = realloc(folded->text, capacity);
+        if (!grown) {
+            emitter->failed = 1;
+            return 0;
+        }
+        folded->text = grown;
+        emitter->text_capacity = capacity;
+    }
+    size_t offset = emitter->text_length;
+    memcpy(folded->text + offset, text, length);
+    emitter->text_length += length;
+    folded->text[emitter->text_length] = '\0';
+    return (uint32_t)offset;
+}
+
+// Mark the nodes the folded tree is built from. A node comes before its
+// parent in the pool, so one pass from the root down reaches them all.
+static void mark_kept(const Ast* ast, Folder* folder) {
+    folder->marks[ast->root] |= FOLD_KEPT;
+    for (NodeId id = ast->root + 1; id-- > 0;) {
+        // Dropped subtrees, and those of literals, are not needed
+        uint8_t marks = folder->marks[id];
+        if (!(marks & FOLD_KEPT) || (marks & FOLD_DROPPED) || folder->values[id] != ATOM_NONE) continue;
+        const ASTNode* node = ast_node(ast, id);
+        for (uint32_t i = 0; i < node->child_count; i++) {
+            folder->marks[ast->children[node->first_child + i]] |= FOLD_KEPT;
+        }
+    }
+}
+
+static void emit_literal(const Ast* ast, NodeId id, Emitter* emitter) {
+    const Folder* folder = emitter->folder;
+    const ASTNode* node = ast_node(ast, id);
+    FoldedProgram* folded = emitter->folded;
+    Atom atom = folder->values[id];
+    Token token = {TOKEN_NUMBER, ERROR_NONE, node->offset, node->length, node->line, atom};
+    if (node->type != AST_NUMBER || atom != node->atom) {
+        token.length = atom_length(folder->atoms, atom);
+        token.offset = append_text(emitter, atom_text(folder->atoms, atom), token.length);
+        folded->folded++;
+    }
+    NodeId literal = ast_add(&folded->tree, AST_NUMBER, token, NULL, 0);
+    if (emitter->failed || literal == AST_NO_NODE) {
+        emitter->failed = 1;
+        return;
+    }
+    emitter->map[id] = literal;
+    folded->names.declarations[literal] = AST_NO_NODE;
+    if (folder->resolution->types[id] == TYPE_BOOL) {
+        folded->names.types[literal] = TYPE_BOOL;
+    } else {
+        folded->names.types[literal] = atom_number(folder->atoms, atom)->kind == NUMBER_FLOAT ? TYPE_FLOAT : TYPE_INT;
+    }
+}
+
+static void emit_node(const Ast* ast, NodeId id, Emitter* emitter) {
+    const Folder* folder = emitter->folder;
+    const Resolution* resolution = folder->resolution;
+    FoldedProgram* folded = emitter->folded;
+    const ASTNode* node = ast_node(ast, id);
+    uint8_t marks = folder->marks[id];
+
+    if (marks & FOLD_DROPPED) {
+        if (node->type == AST_IF || node->type == AST_WHILE) folded->removed++;
+        return;
+    }
+    if (folder->values[id] != ATOM_NONE) {
+        emit_literal(ast, id, emitter);
+        return;
+    }
+    if (marks & (FOLD_TO_LEFT | FOLD_TO_RIGHT)) {
+        emitter->map[id] = emitter->map[ast_child(ast, id, marks & FOLD_TO_LEFT ? 0 : 1)];
+        folded->folded++;
+        return;
+    }
+
+    // Anything else is copied, less the children that were dropped
+    if (node->child_count > emitter->child_capacity) {
+        NodeId* grown = realloc(emitter->children, node->child_count * sizeof(NodeId));
+        if (!grown) {
+            emitter->failed = 1;
+            return;
+        }
+        emitter->children = grown;
+        emitter->child_capacity = node->child_count;
+    }
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        NodeId child = emitter->map[ast_child(ast, id, i)];
+        if (child != AST_NO_NODE) emitter->children[count++] = child;
+    }
+    Token token = {node->token_type, node->error, node->offset, node->length, node->line, node->atom};
+    NodeId copy = ast_add(&folded->tree, node->type, token, emitter->children, count);
+    if (copy == AST_NO_NODE) {
+        emitter->failed = 1;
+        return;
+    }
+    emitter->map[id] = copy;
+    // Declarations come before the names that refer to them
+    NodeId declaration = resolution->declarations[id];
+    folded->names.declarations[copy] = declaration == id ? copy
+        : declaration == AST_NO_NODE ? AST_NO_NODE : emitter->map[declaration];
+    folded->names.types[copy] = resolution->types[id];
+}
+
+// Build the folded tree into folded->tree, folded->names and folded->text
+static int rebuild(const Ast* ast, const char* source, const Folder* folder, FoldedProgram* folded) {
+    uint32_t count = ast->count;
+    size_t source_length = strlen(source);
+    Emitter emitter = {0};
+    emitter.folder = folder;
+    emitter.folded = folded;
+    emitter.map = malloc(count * sizeof(NodeId));
+    emitter.text_length = source_length;
+    emitter.text_capacity = source_length + 1;
+    folded->text = malloc(source_length + 1);
+    // The folded tree is never larger than the original
+    folded->tree.nodes = malloc(count * sizeof(ASTNode));
+    folded->tree.capacity = count;
+    folded->tree.children = malloc((ast->child_total + 1) * sizeof(NodeId));
+    folded->tree.child_capacity = ast->child_total + 1;
+    folded->names.declarations = malloc(count * sizeof(NodeId));
+    folded->names.types = malloc(count);
+    emitter.failed = !emitter.map || !folded->text || !folded->tree.nodes || !folded->tree.children ||
+                     !folded->names.declarations || !folded->names.types;
+
+    if (!emitter.failed) {
+        memcpy(folded->text, source, source_length + 1);
+        memset(emitter.map, 0xff, count * sizeof(NodeId));
+        for (NodeId id = 0; id <= ast->root && !emitter.failed; id++) {
+            if (folder->marks[id] & FOLD_KEPT) emit_node(ast, id, &emitter);
+        }
+    }
+    if (!emitter.failed) {
+        folded->tree.root = emitter.map[ast->root];
+        folded->names.count = folded->tree.count;
+        folded->ast = &folded->tree;
+        folded->resolution = &folded->names;
+        folded->source = folded->text;
+    }
+    free(emitter.map);
+    free(emitter.children);
+    return !emitter.failed;
+}
+
+int fold_constants(const Ast* ast, const char* source, const Resolution* resolution, InternTable* atoms,
+                   FoldedProgram* folded) {
+    memset(folded, 0, sizeof(*folded));
+    ast_init(&folded->tree);
+    folded->ast = ast;
+    folded->resolution = resolution;
+    folded->source = source;
+    if (ast->root == AST_NO_NODE) return 1;
+
+    Folder folder = {resolution, atoms, calloc(ast->count, sizeof(Atom)), calloc(ast->count, 1), 0, 0};
+    int ok = folder.values && folder.marks;
+    if (ok) {
+        // Nodes are in post-order, so each one's children are decided first
+        for (NodeId id = 0; id < ast->count && !folder.failed; id++) decide(ast, id, &folder);
+        ok = !folder.failed;
+    }
+    // A program where nothing folds is its own folded program
+    if (ok && folder.changed) {
+        mark_kept(ast, &folder);
+        ok = rebuild(ast, source, &folder, folded);
+    }
+
+    free(folder.values);
+    free(folder.marks);
+    if (!ok) {
+        folded_program_free(folded);
+        return 0;
+    }
+    return 1;
+}
+
+void folded_program_free(FoldedProgram* folded) {
+    ast_free(&folded->tree);
+    resolution_free(&folded->names);
+    free(folded->text);
+    folded->text = NULL;
+    folded->ast = NULL;
+    folded->resolution = NULL;
+    folded->source = NULL;
+    folded->folded = 0;
+    folded->removed = 0;
+}
@@ -2,248 +2,423 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../../include/parser.h"
-#include "../../include/lexer.h"
 #include "../../include/tokens.h"
 #include "../../include/semantic.h"
 #include "../../include/symbol.h"
-
-VarType get_type_from_token(Token token);
-VarType get_type(ASTNode* node, SymbolTable* table);
-const char* get_type_name(VarType type);
-void semantic_error(SemanticErrorType error, const char* name, int line);
-int analyze_semantics(ASTNode* ast, SymbolTable* table);
+#include "../../include/cfg.h"
+#include "../../include/dataflow.h"
+
+VarType get_type_from_token(TokenType token_type);
+void semantic_error(Sink* out, SemanticErrorType error, const char* name, int line);
+
+// What the analysis has learned about a node
+#define NODE_ASSIGNED 1         // An identifier whose variable is definitely assigned where it is read
+#define NODE_FAILED 2           // An expression whose type error has been counted
+#define NODE_DEFINES 4          // An assignment whose types allow it, so it assigns its variable
+
+// State of the checking pass. Names were resolved before it, so checks
+// read declarations and types off the resolution instead of looking names
+// up. The pass checks each node once, after its children, so an
+// expression's operands have been checked by the time it is; a type error
+// is reported at the innermost expression it shows up in, and the
+// expressions around it fail quietly.
+typedef struct {
+    SymbolTable* table;
+    const Resolution* resolution;
+    uint8_t* flags;             // NODE_* bits, indexed by NodeId
+    int errors;
+} Checker;
 
 // Check a variable declaration
-int check_declaration(ASTNode* node, SymbolTable* table);
+int check_declaration(const Ast* ast, NodeId id, Checker* checker);
 
 // Check a variable assignment
-int check_assignment(ASTNode* node, SymbolTable* table);
+int check_assignment(const Ast* ast, NodeId id, Checker* checker);
 
 // Check an expression for type correctness
-int check_expression(ASTNode* node, SymbolTable* table);
+int check_expression(const Ast* ast, NodeId id, Checker* checker);
 
 // Check a block of statements, handling scope
-int check_block(ASTNode* node, SymbolTable* table);
+int check_block(const Ast* ast, NodeId id, SymbolTable* table);
 
 // Check a condition (e.g., in if statements)
-int check_condition(ASTNode* node, SymbolTable* table);
+int check_condition(const Ast* ast, NodeId id, SymbolTable* table);
+
+// Interned text of an identifier or literal node
+static const char* node_name(const ASTNode* node, SymbolTable* table) {
+    return atom_text(table->atoms, node->atom);
+}
 
-void semantic_error(SemanticErrorType error, const char* name, int line) {
-    printf("Semantic Error at line %d: ", line);
+void semantic_error(Sink* out, SemanticErrorType error, const char* name, int line) {
+    sink_printf(out, "Semantic Error at line %d: ", line);
     switch (error) {
         case SEM_ERROR_REDECLARED_VARIABLE:
-            printf("Variable %s already declared within the same scope. \n", name);
+            sink_printf(out, "Variable %s already declared within the same scope. \n", name);
             break;
         case SEM_ERROR_UNDECLARED_VARIABLE:
-            printf("Attempting to use an undeclared variable '%s'. \n", name);
+            sink_printf(out, "Attempting to use an undeclared variable '%s'. \n", name);
             break;
         case SEM_ERROR_UNINITIALIZED_VARIABLE:
-            printf("Attempting to use an uninitialized variable '%s'. \n", name);
+            sink_printf(out, "Attempting to use an uninitialized variable '%s'. \n", name);
             break;
         case SEM_ERROR_TYPE_MISMATCH:
-            printf("Type mismatch for variable '%s'.\n", name);
+            sink_printf(out, "Type mismatch for variable '%s'.\n", name);
             break;
         case SEM_ERROR_UNKNOWN_TYPE:
-            printf("Unknown type for variable '%s'.\n", name);
+            sink_printf(out, "Unknown type for variable '%s'.\n", name);
             break;
         default:
-            printf("Unknown error\n");
+            sink_puts(out, "Unknown error\n");
     }
 }
 
-void throw_mismatch_error(VarType left, VarType right, int line)
+void throw_mismatch_error(Sink* out, VarType left, VarType right, int line)
 {
-    printf("Line %d: Type mismatch between '%s' & '%s'. \n", line, get_type_name(left), get_type_name(right));
+    sink_printf(out, "Line %d: Type mismatch between '%s' & '%s'. \n", line, get_type_name(left), get_type_name(right));
 }
 
-
-int check_declaration(ASTNode* node, SymbolTable* table) {
-    Symbol* already_declared = lookup_symbol(table, node->left->token.lexeme);
+// Resolution walk: declares variables and opens and closes scopes on the
+// way down, as the checks used to, and types expressions on the way up
+typedef struct {
+    SymbolTable* table;
+    Resolution* resolution;
+} Resolver;
+
+// A variable is visible from its declaration on. A repeated declaration in
+// the same scope declares nothing and refers back to the first.
+static void resolve_declaration(const Ast* ast, NodeId id, Resolver* resolver) {
+    SymbolTable* table = resolver->table;
+    const ASTNode* node = ast_node(ast, id);
+    NodeId name_id = ast_child(ast, id, 0);
+    if (name_id == AST_NO_NODE) return; // Syntax error already reported
+    const ASTNode* name = ast_node(ast, name_id);
+
+    Symbol* already_declared = lookup_symbol(table, name->atom);
     if (already_declared != NULL && already_declared->scope_level == table->current_scope) {
-        semantic_error(SEM_ERROR_REDECLARED_VARIABLE, node->left->token.lexeme, node->token.line);
-        return 1;
+        resolver->resolution->declarations[id] = already_declared->declaration;
+        return;
+    }
+    resolver->resolution->declarations[id] = id;
+    add_symbol(table, name->atom, get_type_from_token(node->token_type), node->line, id);
+}
+
+static AstWalkAction resolve_enter(const Ast* ast, NodeId id, uint32_t depth, void* context) {
+    Resolver* resolver = context;
+    (void)depth;
+
+    switch (ast_node(ast, id)->type) {
+        case AST_VARDECL:
+            resolve_declaration(ast, id, resolver);
+            break;
+        case AST_BLOCK:
+            enter_scope(resolver->table);
+            break;
+        default:
+            break;
+    }
+    return AST_WALK_CONTINUE;
+}
+
+static void resolve_leave(const Ast* ast, NodeId id, uint32_t depth, void* context) {
+    Resolver* resolver = context;
+    SymbolTable* table = resolver->table;
+    Resolution* resolution = resolver->resolution;
+    const ASTNode* node = ast_node(ast, id);
+    Symbol* symbol;
+    VarType left;
+    (void)depth;
+
+    switch (node->type) {
+        case AST_NUMBER:
+            // The lexer decoded literals with a fraction as floats
+            resolution->types[id] = atom_number(table->atoms, node->atom)->kind == NUMBER_FLOAT ? TYPE_FLOAT : TYPE_INT;
+            break;
+        case AST_STRING:
+            resolution->types[id] = TYPE_STRING;
+            break;
+        case AST_CHAR:
+            resolution->types[id] = TYPE_CHAR;
+            break;
+        case AST_IDENTIFIER:
+            symbol = lookup_symbol(table, node->atom);
+            if (symbol != NULL) {
+                resolution->declarations[id] = symbol->declaration;
+                resolution->types[id] = symbol->type;
+            }
+            break;
+        case AST_BINOP:
+            // Arithmetic needs two operands of one type, and not strings
+            if (node->child_count < 2) break;
+            left = resolution->types[ast_child(ast, id, 0)];
+            if (left == resolution->types[ast_child(ast, id, 1)] && left != TYPE_STRING) {
+                resolution->types[id] = left;
+            }
+            break;
+        case AST_COMPOP: // Comparisons can be done between any var
+            resolution->types[id] = TYPE_BOOL;
+            break;
+        case AST_BLOCK:
+            // The block's scope ends after its last statement, even when
+            // the closing '}' was missing
+            exit_scope(table);
+            break;
+        default:
+            break;
     }
+}
+
+int resolve_names(const Ast* ast, SymbolTable* table, Resolution* resolution) {
+    resolution->count = ast->count;
+    resolution->declarations = malloc(ast->count * sizeof(NodeId));
+    resolution->types = malloc(ast->count);
+    if (!resolution->declarations || !resolution->types) return 0;
+    memset(resolution->declarations, 0xff, ast->count * sizeof(NodeId));
+    memset(resolution->types, TYPE_ERROR, ast->count);
+
+    Resolver resolver = {table, resolution};
+    return ast_walk(ast, ast->root, resolve_enter, resolve_leave, &resolver);
+}
 
-    VarType type = get_type_from_token(node->token);
-    add_symbol(table, node->left->token.lexeme, type, node->token.line);
+void resolution_free(Resolution* resolution) {
+    free(resolution->declarations);
+    free(resolution->types);
+    resolution->declarations = NULL;
+    resolution->types = NULL;
+    resolution->count = 0;
+}
+
+int check_declaration(const Ast* ast, NodeId id, Checker* checker) {
+    const ASTNode* node = ast_node(ast, id);
+    NodeId name_id = ast_child(ast, id, 0);
+    if (name_id == AST_NO_NODE) return 0; // Syntax error already reported
+    const ASTNode* name = ast_node(ast, name_id);
+
+    if (checker->resolution->declarations[id] != id) {
+        semantic_error(checker->table->out, SEM_ERROR_REDECLARED_VARIABLE, node_name(name, checker->table), node->line);
+        return 1;
+    }
     return 0;
 }
 
-// This checks the syntax for operations (either comparisons or math)
-int check_expression(ASTNode* node, SymbolTable* table){
-    if(node->right->type == AST_IDENTIFIER){
-        Symbol* right = lookup_symbol(table, node->right->token.lexeme);
-        if (right == NULL){
-            semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, node->right->token.lexeme, node->token.line);
-            return 1;
-        }
+// Reports a use of an identifier that is undeclared or not yet assigned
+static int check_use(const Ast* ast, NodeId id, int line, Checker* checker) {
+    SymbolTable* table = checker->table;
+    const ASTNode* node = ast_node(ast, id);
+    NodeId declaration = checker->resolution->declarations[id];
+    if (declaration == AST_NO_NODE) {
+        semantic_error(table->out, SEM_ERROR_UNDECLARED_VARIABLE, node_name(node, table), line);
+        return 1;
+    }
+    if (!(checker->flags[id] & NODE_ASSIGNED)) {
+        semantic_error(table->out, SEM_ERROR_UNINITIALIZED_VARIABLE, node_name(node, table), line);
+        return 1;
+    }
+    return 0;
+}
 
-        if (right->is_initialized == 0){ 
-            semantic_error(SEM_ERROR_UNINITIALIZED_VARIABLE, node->right->token.lexeme, node->token.line);
-            return 1;
-        };
+// Checks an operand where it is used: reports it if it is an undeclared
+// or uninitialized identifier, and counts it if it is missing
+static int check_operand(const Ast* ast, NodeId id, const ASTNode* op, Checker* checker) {
+    if (id == AST_NO_NODE) return 1; // Syntax error already reported
+    if (ast_node(ast, id)->type == AST_IDENTIFIER) {
+        return check_use(ast, id, op->line, checker);
     }
+    return 0;
+}
 
-    if(node->left->type == AST_IDENTIFIER){
-        Symbol* left = lookup_symbol(table, node->left->token.lexeme);
-        if (left == NULL){
-            semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, node->left->token.lexeme, node->token.line);
-            return 1;
-        }
+// An operand whose own check failed, already counted
+static int operand_failed(NodeId id, const Checker* checker) {
+    return id != AST_NO_NODE && (checker->flags[id] & NODE_FAILED);
+}
 
-        if (left->is_initialized == 0){ 
-            semantic_error(SEM_ERROR_UNINITIALIZED_VARIABLE, node->left->token.lexeme, node->token.line);
-            return 1;
-        };
+// This checks the syntax for operations (either comparisons or math). Runs
+// after the operands were checked, so it only looks at their two types.
+int check_expression(const Ast* ast, NodeId id, Checker* checker){
+    const ASTNode* node = ast_node(ast, id);
+    NodeId left_id = ast_child(ast, id, 0);
+    NodeId right_id = ast_child(ast, id, 1);
+    // A comparison is a bool whatever its operands were, so only
+    // arithmetic passes a failure on
+    uint8_t failed = node->type == AST_BINOP ? NODE_FAILED : 0;
+
+    int errors = check_operand(ast, left_id, node, checker) + check_operand(ast, right_id, node, checker);
+    if (errors || operand_failed(left_id, checker) || operand_failed(right_id, checker)) {
+        checker->flags[id] |= failed;
+        return errors;
     }
 
     // Check Type
-    VarType left_type = get_type(node->left, table);
-    VarType right_type = get_type(node->right, table);
+    VarType left_type = checker->resolution->types[left_id];
+    VarType right_type = checker->resolution->types[right_id];
 
     if (left_type == TYPE_ERROR || right_type == TYPE_ERROR) {
+        checker->flags[id] |= failed;
         return 1;
     }
 
     if (left_type != right_type) {
-        throw_mismatch_error(left_type, right_type, node->token.line);
+        throw_mismatch_error(checker->table->out, left_type, right_type, node->line);
+        checker->flags[id] |= failed;
         return 1;
     }
 
-    
     return 0;
-    
 }
 
-// Check a variable assignment
-int check_assignment(ASTNode* node, SymbolTable* table) {
-    Symbol* left = lookup_symbol(table, node->left->token.lexeme);
-    if (left == NULL) {
-        semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, node->left->token.lexeme, node->token.line);
-        return 1;
-    }
-
-    VarType right_type = get_type(node->right, table);
+// Why an assignment to a declared variable cannot be made, judged by the
+// types resolution found. Decides, before the checks, which assignments
+// assign their variable, and then what check_assignment reports.
+typedef enum {
+    ASSIGNMENT_OK,
+    ASSIGNMENT_NO_VALUE,        // The value is missing or has no type
+    ASSIGNMENT_MISMATCH,        // The value is of another type
+    ASSIGNMENT_BAD_LITERAL      // Not the literal a char or string needs
+} AssignmentProblem;
+
+static AssignmentProblem assignment_problem(const Ast* ast, NodeId id, const Resolution* resolution) {
+    NodeId name_id = ast_child(ast, id, 0);
+    NodeId value_id = ast_child(ast, id, 1);
+    if (value_id == AST_NO_NODE) return ASSIGNMENT_NO_VALUE; // Syntax error already reported
+    VarType left_type = resolution->types[name_id];
+    VarType right_type = resolution->types[value_id];
     if (right_type == TYPE_ERROR) {
-        return 1;
+        return ASSIGNMENT_NO_VALUE;
     }
-    short int_to_float = ((left->type == TYPE_INT && right_type == TYPE_FLOAT) ||
-    (left->type == TYPE_FLOAT && right_type == TYPE_INT));
+    const ASTNode* value = ast_node(ast, value_id);
+    short int_to_float = ((left_type == TYPE_INT && right_type == TYPE_FLOAT) ||
+    (left_type == TYPE_FLOAT && right_type == TYPE_INT));
 
-    if (left->type != right_type && !int_to_float) {
-        throw_mismatch_error(left->type, right_type, node->token.line);
-        return 1;
+    if (left_type != right_type && !int_to_float) {
+        return ASSIGNMENT_MISMATCH;
     }
 
-    switch (left->type) {
+    switch (left_type) {
         case TYPE_CHAR:
-            if (node->right->type == AST_STRING && strlen(node->right->token.lexeme) != 3) {
-                // Character literals should be of the form 'c'
-                semantic_error(SEM_ERROR_TYPE_MISMATCH, node->left->token.lexeme, node->token.line);
-                return 1;
-            }
+            // Character literals should be of the form 'c'
+            if (value->type == AST_STRING && value->length != 3) return ASSIGNMENT_BAD_LITERAL;
             break;
         case TYPE_STRING:
-            if (node->right->type != AST_STRING) {
-                semantic_error(SEM_ERROR_TYPE_MISMATCH, node->left->token.lexeme, node->token.line);
-                return 1;
-            }
+            if (value->type != AST_STRING) return ASSIGNMENT_BAD_LITERAL;
             break;
         default:
             break;
-    }    
-    left->is_initialized = 1;
-    return 0;
+    }
+    return ASSIGNMENT_OK;
 }
 
-// Check a block of statements, handling scope
-int check_block(ASTNode* node, SymbolTable* table);
-
-// Check a condition (e.g., in if statements)
-int check_condition(ASTNode* node, SymbolTable* table);
+// Check a variable assignment
+int check_assignment(const Ast* ast, NodeId id, Checker* checker) {
+    SymbolTable* table = checker->table;
+    const ASTNode* node = ast_node(ast, id);
+    NodeId name_id = ast_child(ast, id, 0);
+    const ASTNode* name = ast_node(ast, name_id);
+    NodeId value_id = ast_child(ast, id, 1);
+
+    NodeId declaration = checker->resolution->declarations[name_id];
+    if (declaration == AST_NO_NODE) {
+        semantic_error(table->out, SEM_ERROR_UNDECLARED_VARIABLE, node_name(name, table), node->line);
+        return 1;
+    }
 
+    // A value whose error was counted where it was found is not checked
+    // again
+    int errors = check_operand(ast, value_id, node, checker);
+    if (errors || operand_failed(value_id, checker)) return errors;
+    switch (assignment_problem(ast, id, checker->resolution)) {
+        case ASSIGNMENT_NO_VALUE:
+            return 1;
+        case ASSIGNMENT_MISMATCH:
+            throw_mismatch_error(table->out, checker->resolution->types[name_id],
+                                 checker->resolution->types[value_id], node->line);
+            return 1;
+        case ASSIGNMENT_BAD_LITERAL:
+            semantic_error(table->out, SEM_ERROR_TYPE_MISMATCH, node_name(name, table), node->line);
+            return 1;
+        default:
+            return 0;
+    }
+}
 
-int process_node(ASTNode* node, SymbolTable* table) { 
-    // print_ast_node(node);
-    int error = 0;
+static void check_node(const Ast* ast, NodeId id, uint32_t depth, void* context) {
+    // print_ast_node(source, ast, id);
+    Checker* checker = context;
+    (void)depth;
 
-    switch(node->type) { 
+    switch(ast_node(ast, id)->type) { 
         case AST_VARDECL:
-            error = check_declaration(node, table);
+            checker->errors += check_declaration(ast, id, checker);
             break;
         
         case AST_ASSIGN:
-            error = check_assignment(node, table);
+            checker->errors += check_assignment(ast, id, checker);
             break;
 
         case AST_BINOP:
         case AST_COMPOP:
-            error = check_expression(node, table);
-            break;
-        
-        case AST_BLOCK:
-            enter_scope(table);
-            break;
-        
-        case AST_BLOCK_END:
-            exit_scope(table);
+            checker->errors += check_expression(ast, id, checker);
             break;
 
-
         default:
             break;
     }
-    if (node->left) error += process_node(node->left, table);
-    if (node->right) error += process_node(node->right, table);
-    return error;   
 }
 
-int analyze_semantics(ASTNode* ast, SymbolTable* table){
-    return process_node(ast, table);
+int process_node(const Ast* ast, NodeId id, Checker* checker) { 
+    if (!ast_walk(ast, id, NULL, check_node, checker)) {
+        sink_puts(checker->table->out, "Out of memory during semantic analysis\n");
+        return checker->errors + 1;
+    }
+    return checker->errors;
 }
 
-// Recursively analyzes nodes
-VarType get_type(ASTNode* node, SymbolTable* table) {
-    if (!node) return TYPE_ERROR; // Null Check
-    VarType left;
-    VarType right;
-    Symbol* symbol;
-    switch (node->type) {
-        case AST_NUMBER:
-            // If constant contains a ., define as a float
-            return (strchr(node->token.lexeme, '.') == NULL) ? TYPE_INT : TYPE_FLOAT;
-        case AST_STRING:
-            return TYPE_STRING;
-        case AST_CHAR:
-            return TYPE_CHAR;
-        case AST_IDENTIFIER:
-            symbol = lookup_symbol(table, node->token.lexeme);
-            if (symbol == NULL) {
-                semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, node->token.lexeme, node->token.line);
-                return TYPE_ERROR;
-            }
-            if (!symbol->is_initialized) {
-                semantic_error(SEM_ERROR_UNINITIALIZED_VARIABLE, node->token.lexeme, node->token.line);
-                return TYPE_ERROR;
-            }
-            return symbol->type;
-        case AST_BINOP:
-            left = get_type(node->left, table);
-            right = get_type(node->right, table);
-            if (left == right && left != TYPE_STRING) {
-                return left;
-            }
-            //semantic_error(SEM_ERROR_TYPE_MISMATCH, node->token.lexeme, node->token.line);
-            return TYPE_ERROR;
-        case AST_COMPOP: // Comparisons can be done between any var
-            return TYPE_BOOL;
-        default:
-            return TYPE_ERROR;
+// Mark the assignments that assign their variable: those to a declared
+// variable that type-check. Whether their operands were assigned does not
+// matter; that is reported where they are read.
+static void mark_definitions(const Ast* ast, Checker* checker) {
+    const Resolution* resolution = checker->resolution;
+    for (NodeId id = 0; id < ast->count; id++) {
+        if (ast_node(ast, id)->type != AST_ASSIGN) continue;
+        NodeId name_id = ast_child(ast, id, 0);
+        if (name_id == AST_NO_NODE || resolution->declarations[name_id] == AST_NO_NODE) continue;
+        if (assignment_problem(ast, id, resolution) == ASSIGNMENT_OK) checker->flags[id] |= NODE_DEFINES;
+    }
+}
+
+// Resolve names, find which uses are definitely assigned on the program's
+// control-flow graph, then check every node
+int analyze_semantics(const Ast* ast, SymbolTable* table, Resolution* resolution) {
+    Checker checker = {table, resolution, calloc(ast->count ? ast->count : 1, 1), 0};
+    uint64_t* at_exit = NULL;
+    int ready = checker.flags && resolve_names(ast, table, resolution);
+    if (ready) {
+        Cfg cfg;
+        mark_definitions(ast, &checker);
+        ready = cfg_build(&cfg, ast, resolution);
+        if (ready) {
+            at_exit = calloc(DATAFLOW_WORDS(cfg.slot_count) + 1, sizeof(uint64_t));
+            ready = at_exit && definite_assignment(&cfg, checker.flags, NODE_DEFINES, NODE_ASSIGNED, at_exit);
+            cfg_free(&cfg);
+        }
     }
+
+    int errors;
+    if (!ready) {
+        sink_puts(table->out, "Out of memory during semantic analysis\n");
+        errors = 1;
+    } else {
+        errors = process_node(ast, ast->root, &checker);
+        // The variables left in the table are the globals, in slots 0 and
+        // up; they are initialized if assigned where the program ends
+        for (uint32_t i = 0; i < table->symbol_count; i++) {
+            table->symbols[i].is_initialized = bitset_test(at_exit, i);
+        }
+    }
+    free(at_exit);
+    free(checker.flags);
+    return errors;
 }
 
-VarType get_type_from_token(Token token) {
-    TokenType token_type = token.type;
+VarType get_type_from_token(TokenType token_type) {
     switch (token_type) {
         case TOKEN_INT:
             return TYPE_INT;
@@ -259,77 +434,3 @@ VarType get_type_from_token(Token token) {
             return TYPE_ERROR;
     }
 }
-
-const char* get_type_name(VarType type) {
-    switch(type) {
-        case TYPE_INT: return "int";
-        case TYPE_FLOAT: return "float";
-        case TYPE_STRING: return "string";
-        case TYPE_CHAR: return "char";
-        case TYPE_BOOL: return "bool";
-        case TYPE_ERROR: return "type_error";
-        default: return "unknown";
-    }
-}
-
-
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Must pass exactly one file to parse");
-        return 1;
-    }
-
-    char *file_buffer;
-    size_t file_size;
-    FILE *fp;
-
-    fp = fopen(argv[1], "r");
-    if (!fp) {
-        fprintf(stderr, "Invalid file path: %s", argv[1]);
-        return 1;
-    } 
-    
-    fseek(fp, 0L, SEEK_END);
-    file_size = ftell(fp);
-    rewind(fp);
-
-    file_buffer = (char *)malloc(file_size + 1);
-    if (!file_buffer) {
-        fprintf(stderr, "Memory allocation error for file %s", argv[1]);
-        fclose(fp);
-        return 1;
-    }
-    memset(file_buffer, 0, file_size + 1);
-    size_t bytes_read = fread(file_buffer, 1, file_size, fp);
-
-    if (bytes_read != file_size) {
-        fprintf(stderr, "Could not read the whole file");
-        fclose(fp);
-        free(file_buffer);
-        return 1;
-    }
-    fclose(fp);
-
-    printf("Parsing input:\n%s\n", file_buffer);
-    parser_init(file_buffer);
-    ASTNode *ast = parse_program();
-
-    printf("\nAbstract Syntax Tree:\n");
-    print_ast(ast, 0);
-
-    SymbolTable* table = init_symbol_table();
-    int res = analyze_semantics(ast, table);
-
-    if (res == 0) { 
-        printf("\nSemantic Analysis Completed Successfully\n");
-    }
-    else { 
-        printf("\nSemantic Analysis Failed With Errors\n");
-    }
-
-    print_table(table);
-    free_symbol_table(table);
-    free_ast(ast);
-    free(file_buffer);
-    return 0;
-}
@@ -1,47 +1,123 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 #include "semantic.h"
 #include "symbol.h"
 
-const char* get_type_name(VarType type);
+#define SYMBOL_INITIAL_SLOTS 64
+#define SYMBOL_INITIAL_CAPACITY 64
 
-SymbolTable* init_symbol_table(void) {
+SymbolTable* init_symbol_table(const InternTable* atoms, Sink* out) {
     SymbolTable* table = malloc(sizeof(SymbolTable));
     if (table) {
-        table->last_symbol = NULL;
+        table->symbols = malloc(SYMBOL_INITIAL_CAPACITY * sizeof(Symbol));
+        table->symbol_count = 0;
+        table->symbol_capacity = SYMBOL_INITIAL_CAPACITY;
+        table->scope_marks = NULL;
+        table->mark_capacity = 0;
         table->current_scope = 0;
+        table->atoms = atoms;
+        table->out = out;
+        table->slots = calloc(SYMBOL_INITIAL_SLOTS, sizeof(SymbolSlot));
+        table->slot_mask = SYMBOL_INITIAL_SLOTS - 1;
+        table->slot_count = 0;
+        if (!table->symbols || !table->slots) {
+            free(table->symbols);
+            free(table->slots);
+            free(table);
+            return NULL;
+        }
     }
     return table;
 }
 
-void add_symbol(SymbolTable* table, const char* name, VarType type, int line) {
-    Symbol* new = malloc(sizeof(Symbol));
-    if (new) {
-        strncpy(new->name, name, sizeof(new->name) - 1);
-        new->name[sizeof(new->name) - 1] = '\0';
-        new->type = type;
-        new->scope_level = table->current_scope;
-        new->line_declared = line;
-        new->is_initialized = 0;
-        new->next = table->last_symbol;
-        table->last_symbol = new;
+// The slot holding `atom`, or the empty slot where it belongs. Atoms are
+// dense small integers, so multiplying by an odd constant spreads them.
+static uint32_t find_slot(const SymbolTable* table, Atom atom) {
+    uint32_t i = (atom * 0x9e3779b1u) & table->slot_mask;
+    while (table->slots[i].atom != ATOM_NONE && table->slots[i].atom != atom) {
+        i = (i + 1) & table->slot_mask;
+    }
+    return i;
+}
+
+static int grow_slots(SymbolTable* table) {
+    uint32_t old_count = table->slot_mask + 1;
+    SymbolSlot* old = table->slots;
+    SymbolSlot* slots = calloc(old_count * 2, sizeof(SymbolSlot));
+    if (!slots) return 0;
+    table->slots = slots;
+    table->slot_mask = old_count * 2 - 1;
+    for (uint32_t i = 0; i < old_count; i++) {
+        if (old[i].atom != ATOM_NONE) table->slots[find_slot(table, old[i].atom)] = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+// Double an array of `*capacity` items; returns it moved, or NULL
+static void* grow_array(void* items, uint32_t* capacity, size_t size) {
+    uint32_t grown_capacity = *capacity ? *capacity * 2 : 16;
+    void* grown = realloc(items, grown_capacity * size);
+    if (grown) *capacity = grown_capacity;
+    return grown;
+}
+
+void add_symbol(SymbolTable* table, Atom atom, VarType type, int line, NodeId declaration) {
+    // Keep the hash table at most half full
+    if ((table->slot_count + 1) * 2 > table->slot_mask + 1 && !grow_slots(table)) return;
+    if (table->symbol_count == table->symbol_capacity) {
+        Symbol* grown = grow_array(table->symbols, &table->symbol_capacity, sizeof(Symbol));
+        if (!grown) return;
+        table->symbols = grown;
     }
+    SymbolId id = table->symbol_count++;
+    Symbol* new = &table->symbols[id];
+    new->atom = atom;
+    new->type = type;
+    new->scope_level = table->current_scope;
+    new->line_declared = line;
+    new->is_initialized = 0;
+    new->shadowed = SYMBOL_NONE;
+    new->declaration = declaration;
+
+    // A name that could not be interned is never found
+    if (atom == ATOM_NONE) return;
+    SymbolSlot* slot = &table->slots[find_slot(table, atom)];
+    if (slot->atom == ATOM_NONE) {
+        slot->atom = atom;
+        slot->symbol = SYMBOL_NONE;
+        table->slot_count++;
+    }
+    new->shadowed = slot->symbol;
+    slot->symbol = id;
 }
 
-Symbol* lookup_symbol(SymbolTable* table, const char* name) {
-    Symbol* curr = table->last_symbol;
-    while (curr) {
-        if (strcmp(curr->name, name) == 0) {
-            return curr;
+Symbol* lookup_symbol(SymbolTable* table, Atom atom) {
+    const SymbolSlot* slot = &table->slots[find_slot(table, atom)];
+    if (atom == ATOM_NONE || slot->atom != atom || slot->symbol == SYMBOL_NONE) return NULL;
+    return &table->symbols[slot->symbol];
+}
+
+Symbol* lookup_symbol_linear(SymbolTable* table, Atom atom) {
+    if (atom == ATOM_NONE) return NULL;
+    for (uint32_t i = table->symbol_count; i-- > 0;) {
+        if (table->symbols[i].atom == atom) {
+            return &table->symbols[i];
         }
-        curr = curr->next;
     }
     return NULL;
 }
 
 void enter_scope(SymbolTable* table) {
     table->current_scope++;
+    uint32_t level = (uint32_t)table->current_scope;
+    if (level > table->mark_capacity) {
+        uint32_t* grown = grow_array(table->scope_marks, &table->mark_capacity, sizeof(uint32_t));
+        // Without a mark, the scope's symbols are found by their level
+        if (!grown) return;
+        table->scope_marks = grown;
+    }
+    table->scope_marks[level - 1] = table->symbol_count;
 }
 
 void exit_scope(SymbolTable* table) {
@@ -50,47 +126,62 @@ void exit_scope(SymbolTable* table) {
 }
 
 void remove_symbols_in_current_scope(SymbolTable* table) {
-    while (table->last_symbol && table->last_symbol->scope_level == table->current_scope) {
-        Symbol* curr = table->last_symbol;
-        table->last_symbol = curr->next;
-        free(curr);
+    int level = table->current_scope;
+    uint32_t mark = table->symbol_count;
+    if (level > 0 && (uint32_t)level <= table->mark_capacity) {
+        mark = table->scope_marks[level - 1];
+    } else {
+        while (mark > 0 && table->symbols[mark - 1].scope_level == level) mark--;
     }
+    // Each name's slot gets back the declaration it shadowed
+    for (uint32_t i = table->symbol_count; i-- > mark;) {
+        const Symbol* symbol = &table->symbols[i];
+        if (symbol->atom != ATOM_NONE) table->slots[find_slot(table, symbol->atom)].symbol = symbol->shadowed;
+    }
+    table->symbol_count = mark;
 }
 
-// Iteratively free all symbols, and then free the table
 void free_symbol_table(SymbolTable* table) {
-    Symbol* curr = table->last_symbol;
-    while (curr) {
-        Symbol* next = curr->next;
-        free(curr);
-        curr = next;
-    }
+    free(table->symbols);
+    free(table->scope_marks);
+    free(table->slots);
     free(table);
 }
 
-void print_table(SymbolTable* table) {
-    printf("\n== SYMBOL TABLE DUMP ==\n");
-    if (!table || !table->last_symbol) {
-        printf("Symbol table is empty.\n");
+void print_table(Sink* out, SymbolTable* table) {
+    sink_puts(out, "\n== SYMBOL TABLE DUMP ==\n");
+    if (!table || table->symbol_count == 0) {
+        sink_puts(out, "Symbol table is empty.\n");
         return;
     }
 
-    Symbol* current = table->last_symbol;
+    // Newest first
     int count = 0;
-    while (current) {
-        printf("Symbol[%d]:\n", count);
-        printf(" Name: %s\n", current->name);
-        printf(" Type: %s\n", get_type_name(current->type));
-        printf(" Scope Level: %d\n", current->scope_level);
-        printf(" Line Declared: %d\n", current->line_declared);
-        printf(" Initialized: %s\n", current->is_initialized ? "Yes" : "No");
-        printf("\n");
-        current = current->next;
+    for (uint32_t i = table->symbol_count; i-- > 0;) {
+        const Symbol* current = &table->symbols[i];
+        sink_printf(out, "Symbol[%d]:\n", count);
+        sink_printf(out, " Name: %s\n", atom_text(table->atoms, current->atom));
+        sink_printf(out, " Type: %s\n", get_type_name(current->type));
+        sink_printf(out, " Scope Level: %d\n", current->scope_level);
+        sink_printf(out, " Line Declared: %d\n", current->line_declared);
+        sink_printf(out, " Initialized: %s\n", current->is_initialized ? "Yes" : "No");
+        sink_puts(out, "\n");
         count++;
     }
 
-    printf("Total symbols: %d\n", count);
-    printf("Current scope level: %d\n", table->current_scope);
-    printf("===================\n");
+    sink_printf(out, "Total symbols: %d\n", count);
+    sink_printf(out, "Current scope level: %d\n", table->current_scope);
+    sink_puts(out, "===================\n");
 }
 
+const char* get_type_name(VarType type) {
+    switch(type) {
+        case TYPE_INT: return "int";
+        case TYPE_FLOAT: return "float";
+        case TYPE_STRING: return "string";
+        case TYPE_CHAR: return "char";
+        case TYPE_BOOL: return "bool";
+        case TYPE_ERROR: return "type_error";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Generate the character-class and transition tables for the DFA lexer.
+
+Rewrites the region between the BEGIN/END GENERATED markers in
+src/lexer/lexer_dfa.c. Run from anywhere:
+
+    python3 tools/gen_lexer_dfa.py
+"""
+
+import os
+import re
+
+# Character classes, in table order
+CLASSES = [
+    "C_OTHER", "C_NUL", "C_SPACE", "C_NEWLINE", "C_LETTER", "C_DIGIT", "C_DOT",
+    "C_DQUOTE", "C_SQUOTE", "C_ARITH", "C_EQUALS", "C_BANG", "C_LTGT",
+    "C_SEMICOLON", "C_LPAREN", "C_RPAREN", "C_LBRACE", "C_RBRACE",
+]
+
+# Scanning states; every state from S_DONE on is final
+STATES = [
+    "S_START", "S_IDENT", "S_INT", "S_FRAC", "S_STRING", "S_CHAR_OPEN",
+    "S_CHAR_ONE", "S_CHAR_EXTRA", "S_EQUALS", "S_BANG", "S_BAD_NUMBER",
+]
+
+# Final states: (name, whether the byte that led here is given back)
+FINALS = [
+    ("D_EOF", 1), ("D_IDENT", 1), ("D_NUMBER", 1), ("D_BAD_NUMBER", 1),
+    ("D_STRING", 0), ("D_STRING_OPEN", 1), ("D_CHAR", 0), ("D_CHAR_EMPTY", 0),
+    ("D_CHAR_LONG", 0), ("D_CHAR_OPEN", 1), ("D_CHAR_LONG_OPEN", 1), ("D_ARITH", 0),
+    ("D_ASSIGN", 1), ("D_EQEQ", 0), ("D_NOT_EQUALS", 0), ("D_BANG", 1),
+    ("D_LTGT", 0), ("D_SEMICOLON", 0), ("D_LPAREN", 0), ("D_RPAREN", 0),
+    ("D_LBRACE", 0), ("D_RBRACE", 0), ("D_INVALID", 0),
+]
+
+
+def char_class(b):
+    c = chr(b)
+    if b == 0:
+        return "C_NUL"
+    if c in " \t":
+        return "C_SPACE"
+    if c == "\n":
+        return "C_NEWLINE"
+    if c.isascii() and (c.isalpha() or c == "_"):
+        return "C_LETTER"
+    if c.isascii() and c.isdigit():
+        return "C_DIGIT"
+    single = {
+        ".": "C_DOT", '"': "C_DQUOTE", "'": "C_SQUOTE", "+": "C_ARITH",
+        "-": "C_ARITH", "*": "C_ARITH", "/": "C_ARITH", "=": "C_EQUALS",
+        "!": "C_BANG", "<": "C_LTGT", ">": "C_LTGT", ";": "C_SEMICOLON",
+        "(": "C_LPAREN", ")": "C_RPAREN", "{": "C_LBRACE", "}": "C_RBRACE",
+    }
+    return single.get(c, "C_OTHER")
+
+
+def transitions():
+    t = {s: {c: None for c in CLASSES} for s in STATES}
+
+    start = t["S_START"]
+    for c in CLASSES:
+        start[c] = "D_INVALID"
+    start.update({
+        "C_NUL": "D_EOF", "C_SPACE": "S_START", "C_NEWLINE": "S_START",
+        "C_LETTER": "S_IDENT", "C_DIGIT": "S_INT", "C_DQUOTE": "S_STRING",
+        "C_SQUOTE": "S_CHAR_OPEN", "C_ARITH": "D_ARITH", "C_EQUALS": "S_EQUALS",
+        "C_BANG": "S_BANG", "C_LTGT": "D_LTGT", "C_SEMICOLON": "D_SEMICOLON",
+        "C_LPAREN": "D_LPAREN", "C_RPAREN": "D_RPAREN", "C_LBRACE": "D_LBRACE",
+        "C_RBRACE": "D_RBRACE",
+    })
+
+    for c in CLASSES:
+        t["S_IDENT"][c] = "S_IDENT" if c in ("C_LETTER", "C_DIGIT") else "D_IDENT"
+        t["S_INT"][c] = {"C_DIGIT": "S_INT", "C_DOT": "S_FRAC"}.get(c, "D_NUMBER")
+        t["S_FRAC"][c] = {"C_DIGIT": "S_FRAC", "C_DOT": "S_BAD_NUMBER"}.get(c, "D_NUMBER")
+        # A second '.' makes the whole run of digits and dots one bad literal
+        t["S_BAD_NUMBER"][c] = "S_BAD_NUMBER" if c in ("C_DIGIT", "C_DOT") else "D_BAD_NUMBER"
+        t["S_STRING"][c] = {"C_DQUOTE": "D_STRING", "C_NUL": "D_STRING_OPEN"}.get(c, "S_STRING")
+        t["S_CHAR_OPEN"][c] = {"C_SQUOTE": "D_CHAR_EMPTY", "C_NUL": "D_CHAR_OPEN"}.get(c, "S_CHAR_ONE")
+        t["S_CHAR_ONE"][c] = {"C_SQUOTE": "D_CHAR", "C_NUL": "D_CHAR_OPEN"}.get(c, "S_CHAR_EXTRA")
+        t["S_CHAR_EXTRA"][c] = {"C_SQUOTE": "D_CHAR_LONG", "C_NUL": "D_CHAR_LONG_OPEN"}.get(c, "S_CHAR_EXTRA")
+        t["S_EQUALS"][c] = "D_EQEQ" if c == "C_EQUALS" else "D_ASSIGN"
+        t["S_BANG"][c] = "D_NOT_EQUALS" if c == "C_EQUALS" else "D_BANG"
+    return t
+
+
+def render():
+    out = []
+    out.append("enum {")
+    for i, name in enumerate(CLASSES):
+        out.append(f"    {name},")
+    out.append("    CHAR_CLASS_COUNT")
+    out.append("};")
+    out.append("")
+    out.append("enum {")
+    for name in STATES:
+        out.append(f"    {name},")
+    for i, (name, _) in enumerate(FINALS):
+        out.append(f"    {name},{'  // First final state' if i == 0 else ''}")
+    out.append("    STATE_COUNT")
+    out.append("};")
+    out.append("")
+    out.append("#define S_DONE D_EOF")
+    out.append("")
+
+    out.append("static const uint8_t char_class[256] = {")
+    for row in range(0, 256, 8):
+        cells = ", ".join(char_class(b) for b in range(row, row + 8))
+        out.append(f"    {cells},")
+    out.append("};")
+    out.append("")
+
+    table = transitions()
+    out.append("static const uint8_t transitions[S_DONE][CHAR_CLASS_COUNT] = {")
+    for s in STATES:
+        out.append(f"    [{s}] = {{")
+        for c in CLASSES:
+            out.append(f"        [{c}] = {table[s][c]},")
+        out.append("    },")
+    out.append("};")
+    out.append("")
+
+    out.append("// 1 when reaching the final state does not consume the last byte read")
+    out.append("static const uint8_t gives_back[STATE_COUNT] = {")
+    for name, back in FINALS:
+        out.append(f"    [{name}] = {back},")
+    out.append("};")
+    return "\n".join(out)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    path = os.path.join(here, "..", "src", "lexer", "lexer_dfa.c")
+    with open(path) as f:
+        text = f.read()
+    begin = "// BEGIN GENERATED by tools/gen_lexer_dfa.py\n"
+    end = "// END GENERATED\n"
+    pattern = re.compile(re.escape(begin) + ".*?" + re.escape(end), re.S)
+    text = pattern.sub(lambda _: begin + render() + "\n" + end, text)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()